@@ -0,0 +1,86 @@
+#include "AllocCounter.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Replacements for every global operator new and delete: plain, array, nothrow and aligned.
+// All of them allocate with malloc, so each delete matches whichever new made the block.
+
+namespace {
+
+std::atomic<unsigned long long> allocations{0};
+
+// nullptr once the new handler gives up (or there is none)
+void* allocate(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    for (;;) {
+        if (void* p = std::malloc(size ? size : 1)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) return nullptr;
+        handler();
+    }
+}
+
+// malloc only promises fundamental alignment: take align bytes more, round up inside the
+// block and keep malloc's pointer just below the aligned one for release
+void* allocateAligned(std::size_t size, std::align_val_t al) {
+    std::size_t align = static_cast<std::size_t>(al);
+    if (align < alignof(void*)) align = alignof(void*);
+    if (size > SIZE_MAX - align - sizeof(void*)) return nullptr;
+    void* raw = allocate(size + align + sizeof(void*));
+    if (!raw) return nullptr;
+    std::uintptr_t at = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + align - 1) & ~(std::uintptr_t)(align - 1);
+    reinterpret_cast<void**>(at)[-1] = raw;
+    return reinterpret_cast<void*>(at);
+}
+
+void release(void* p) noexcept { std::free(p); }
+void releaseAligned(void* p) noexcept {
+    if (p) std::free(static_cast<void**>(p)[-1]);
+}
+
+void* orThrow(void* p) {
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+// the nothrow forms return nullptr where the others throw, including from a new handler
+template <typename F>
+void* orNull(F&& f) noexcept {
+    try {
+        return f();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+}
+
+unsigned long long allocationCount() { return allocations.load(std::memory_order_relaxed); }
+
+void* operator new(std::size_t size) { return orThrow(allocate(size)); }
+void* operator new[](std::size_t size) { return orThrow(allocate(size)); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return orNull([&] { return allocate(size); }); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return orNull([&] { return allocate(size); }); }
+void* operator new(std::size_t size, std::align_val_t al) { return orThrow(allocateAligned(size, al)); }
+void* operator new[](std::size_t size, std::align_val_t al) { return orThrow(allocateAligned(size, al)); }
+void* operator new(std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return orNull([&] { return allocateAligned(size, al); });
+}
+void* operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return orNull([&] { return allocateAligned(size, al); });
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, std::size_t) noexcept { release(p); }
+void operator delete[](void* p, std::size_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(p); }
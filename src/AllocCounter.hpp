@@ -0,0 +1,6 @@
+#pragma once
+
+// Heap allocations made through any form of operator new since the program started. Only
+// programs that link AllocCounter.cpp count them (it replaces the global allocation
+// functions); the bench tool does, the GUI and crossword_batch keep the default allocator.
+unsigned long long allocationCount();
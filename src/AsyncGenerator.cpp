@@ -0,0 +1,76 @@
+#include "AsyncGenerator.hpp"
+
+AsyncGenerator::~AsyncGenerator() {
+    cancel();
+    join();
+}
+
+void AsyncGenerator::join() {
+    if (worker.joinable()) worker.join();
+}
+
+bool AsyncGenerator::start(const CrosswordGrid& grid, std::vector<std::string> wordList,
+                           Generator::Strategy strategy, unsigned long long maxNodes, double maxSeconds) {
+    return launch(grid, std::move(wordList), nullptr, strategy, maxNodes, maxSeconds);
+}
+
+bool AsyncGenerator::start(const CrosswordGrid& grid, std::shared_ptr<const WordIndex> index,
+                           Generator::Strategy strategy, unsigned long long maxNodes, double maxSeconds) {
+    if (!index) return false;
+    return launch(grid, {}, std::move(index), strategy, maxNodes, maxSeconds);
+}
+
+bool AsyncGenerator::launch(const CrosswordGrid& grid, std::vector<std::string> wordList,
+                            std::shared_ptr<const WordIndex> index, Generator::Strategy strategy,
+                            unsigned long long maxNodes, double maxSeconds) {
+    if (running()) return false;
+    join();
+    cancelFlag = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        latest = Generator::Progress();
+        result = grid;
+    }
+    status = static_cast<int>(State::Running);
+
+    worker = std::thread([this, words = std::move(wordList), index = std::move(index), strategy, maxNodes, maxSeconds]() {
+        Generator gen;
+        gen.setStrategy(strategy);
+        gen.setCancelFlag(&cancelFlag);
+        gen.setBudget(maxNodes, maxSeconds);
+        gen.setProgressCallback([this](const Generator::Progress& p) {
+            std::lock_guard<std::mutex> lock(mutex);
+            latest = p;
+        });
+        // the worker owns `result` until it publishes a final state
+        bool ok;
+        if (index) {
+            gen.useWords(index.get());
+            ok = gen.generate(result);
+        } else {
+            ok = gen.generate(result, words);
+        }
+        State final = ok ? State::Succeeded : (gen.getStats().cancelled ? State::Cancelled : State::Failed);
+        status = static_cast<int>(final);
+    });
+    return true;
+}
+
+void AsyncGenerator::cancel() {
+    cancelFlag = true;
+}
+
+Generator::Progress AsyncGenerator::progress() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return latest;
+}
+
+bool AsyncGenerator::takeResult(CrosswordGrid& out) {
+    State s = state();
+    if (s == State::Running || s == State::Idle) return false;
+    join();
+    status = static_cast<int>(State::Idle);
+    if (s != State::Succeeded) return false;
+    out = result;
+    return true;
+}
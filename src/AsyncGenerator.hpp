@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CrosswordGrid.hpp"
+#include "Generator.hpp"
+
+// Runs Generator::generate on a worker thread against a private copy of the grid, so the
+// caller (the GUI render loop) never blocks. Poll state() once per frame, read progress()
+// for display and collect the filled grid with takeResult().
+class AsyncGenerator {
+public:
+    enum class State { Idle, Running, Succeeded, Failed, Cancelled };
+
+    AsyncGenerator() = default;
+    ~AsyncGenerator();
+    AsyncGenerator(const AsyncGenerator&) = delete;
+    AsyncGenerator& operator=(const AsyncGenerator&) = delete;
+
+    // Returns false if a fill is already running. 0 budgets mean unlimited.
+    bool start(const CrosswordGrid& grid, std::vector<std::string> wordList,
+               Generator::Strategy strategy = Generator::Strategy::MostConstrained,
+               unsigned long long maxNodes = 0, double maxSeconds = 0.0);
+    // Same, searching a prebuilt index (kept alive for the length of the fill)
+    bool start(const CrosswordGrid& grid, std::shared_ptr<const WordIndex> index,
+               Generator::Strategy strategy = Generator::Strategy::MostConstrained,
+               unsigned long long maxNodes = 0, double maxSeconds = 0.0);
+    // Ask the search to stop at its next checkpoint; state() becomes Cancelled shortly after
+    void cancel();
+    State state() const { return static_cast<State>(status.load()); }
+    bool running() const { return state() == State::Running; }
+    // Latest snapshot published by the search
+    Generator::Progress progress() const;
+    // Copy the filled grid out once state() is Succeeded; returns to Idle either way
+    bool takeResult(CrosswordGrid& out);
+
+private:
+    std::thread worker;
+    std::atomic<bool> cancelFlag{false};
+    std::atomic<int> status{static_cast<int>(State::Idle)};
+    mutable std::mutex mutex;
+    Generator::Progress latest;
+    CrosswordGrid result{1, 1};
+
+    void join();
+    bool launch(const CrosswordGrid& grid, std::vector<std::string> wordList, std::shared_ptr<const WordIndex> index,
+                Generator::Strategy strategy, unsigned long long maxNodes, double maxSeconds);
+};
@@ -1,7 +0,0 @@
-#pragma once
-
-struct Cell {
-    char letter = ' ';
-    bool isBlocked = false;
-    bool isEditable = true;
-};
@@ -1,33 +1,149 @@
 #include "CrosswordGrid.hpp"
+#include "GridBits.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <string>
-#include <random>
-#include <ctime>
 
-CrosswordGrid::CrosswordGrid(int r, int c) : rows(r), cols(c) {
-    grid.resize(rows, std::vector<Cell>(cols));
-    clueNumbers.resize(rows, std::vector<int>(cols, 0));
+namespace {
+
+// Binary puzzle layout: PuzzleHeader, then the body:
+//  - three bitmaps of (rows * cols + 7) / 8 bytes: blocked, given and numbered cells (bit
+//    i % 8 of byte i / 8 is cell i); numbers count up over the numbered cells in order
+//  - the slot table, slotBytes long: acrossSlots across slots, then the down slots, in
+//    buildSlots order. Each is the varint gap << 4 | min(length, 15), followed by the
+//    varint length - 15 when that nibble is 15. The gap is counted from the end of the
+//    previous slot of the same direction, row-major for across slots and column-major for
+//    down slots, so most slots take a single byte
+//  - with PuzzleHasLetters, the letter of every open cell in row-major order: 5 bits each
+//    (0 for ' ', 1-26 for A-Z), or one byte each with PuzzleRawLetters
+// All fields are in the writer's byte order; byteOrder lets a reader with the other order
+// refuse the file.
+struct PuzzleHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t rows, cols;
+    uint32_t flags;
+    uint32_t openCells;
+    uint32_t slotCount;
+    uint32_t acrossSlots;
+    uint32_t slotBytes;
+    uint32_t reserved; // 0
+    uint64_t checksum; // over the body, see checksum()
+};
+static_assert(sizeof(PuzzleHeader) == 56, "puzzle header must stay 56 bytes");
+
+const char PuzzleMagic[8] = { 'C', 'W', 'P', 'U', 'Z', 'Z', 0, 0 };
+const uint32_t PuzzleVersion = 1;
+const uint32_t PuzzleByteOrder = 0x01020304u;
+const uint32_t PuzzleHasLetters = 1u;
+const uint32_t PuzzleRawLetters = 2u;
+const uint32_t PuzzleMaxSide = 0xFFFFu;
+const uint64_t PuzzleMaxCells = INT_MAX; // cell indices are int
+
+// FNV-1a taken a 64-bit word at a time (then the tail bytes), so one multiply covers eight
+// bytes. Multiplying by an odd prime keeps the lowest differing bit, so a changed byte
+// always changes the result.
+uint64_t checksum(const unsigned char* p, size_t n) {
+    uint64_t h = 1469598103934665603ull;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, sizeof(w));
+        h = (h ^ w) * 1099511628211ull;
+    }
+    for (; i < n; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+uint64_t bitmapBytes(const PuzzleHeader& h) { return ((uint64_t)h.rows * h.cols + 7) / 8; }
+
+uint64_t letterBytes(const PuzzleHeader& h) {
+    if (!(h.flags & PuzzleHasLetters)) return 0;
+    return (h.flags & PuzzleRawLetters) ? h.openCells : ((uint64_t)h.openCells * 5 + 7) / 8;
 }
 
-void CrosswordGrid::setLetter(int r, int c, char letter) {
-    if (!grid[r][c].isBlocked && grid[r][c].isEditable)
-        grid[r][c].letter = letter;
+uint64_t bodySize(const PuzzleHeader& h) { return 3 * bitmapBytes(h) + h.slotBytes + letterBytes(h); }
+
+// Read and check the header of an open stream; leaves it positioned at the body
+bool readHeader(std::istream& in, PuzzleHeader& h) {
+    in.seekg(0, std::ios::end);
+    uint64_t size = (uint64_t)in.tellg();
+    in.seekg(0, std::ios::beg);
+    if (!in || size < sizeof(PuzzleHeader)) return false;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h))) return false;
+    // every slot covers at least two cells and takes 1 to 13 bytes
+    return std::memcmp(h.magic, PuzzleMagic, sizeof(h.magic)) == 0 && h.version == PuzzleVersion &&
+           h.byteOrder == PuzzleByteOrder && (h.flags & ~(PuzzleHasLetters | PuzzleRawLetters)) == 0 &&
+           h.reserved == 0 && h.rows > 0 && h.cols > 0 && h.rows <= PuzzleMaxSide && h.cols <= PuzzleMaxSide &&
+           (uint64_t)h.rows * h.cols <= PuzzleMaxCells &&
+           h.openCells <= (uint64_t)h.rows * h.cols && h.slotCount <= h.openCells && h.acrossSlots <= h.slotCount &&
+           h.slotBytes >= h.slotCount && h.slotBytes <= 13 * (uint64_t)h.slotCount &&
+           size == sizeof(PuzzleHeader) + bodySize(h);
+}
+
+int lowestBit(unsigned x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(x);
+#else
+    int n = 0;
+    while (!(x & 1)) { x >>= 1; ++n; }
+    return n;
+#endif
+}
+
+int popcount(unsigned x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(x);
+#else
+    int n = 0;
+    for (; x; x &= x - 1) ++n;
+    return n;
+#endif
 }
 
-char CrosswordGrid::getLetter(int r, int c) const {
-    return grid[r][c].letter;
+void putVarint(std::vector<unsigned char>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((unsigned char)v);
 }
 
-bool CrosswordGrid::isBlocked(int r, int c) const {
-    return grid[r][c].isBlocked;
+bool getVarint(const unsigned char*& p, const unsigned char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        unsigned char b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
 }
 
-bool CrosswordGrid::inBounds(int r, int c) const {
-    return r >= 0 && r < rows && c >= 0 && c < cols;
+}
+
+CrosswordGrid::CrosswordGrid(int r, int c) : rows(r), cols(c) {
+    letters.assign((size_t)rows * cols, ' ');
+    flags.assign((size_t)rows * cols, Editable);
+    clueNumbers.assign((size_t)rows * cols, 0);
+}
+
+void CrosswordGrid::setBlocked(int r, int c, bool blocked) {
+    int i = index(r, c);
+    letters[i] = ' ';
+    flags[i] = blocked ? Blocked : Editable;
+}
+
+bool CrosswordGrid::isBinaryPuzzle(const std::string& path) {
+    return path.size() > 4 && path.compare(path.size() - 4, 4, ".cwp") == 0;
 }
 
 bool CrosswordGrid::loadFromFile(const std::string& path) {
+    if (isBinaryPuzzle(path)) return loadBinary(path);
     std::ifstream in(path);
     if (!in)
         return false;
@@ -39,10 +155,9 @@ bool CrosswordGrid::loadFromFile(const std::string& path) {
     std::getline(in, line); // consume rest of line
 
     rows = r; cols = c;
-    grid.clear();
-    grid.resize(rows, std::vector<Cell>(cols));
-    clueNumbers.clear();
-    clueNumbers.resize(rows, std::vector<int>(cols, 0));
+    letters.assign((size_t)rows * cols, ' ');
+    flags.assign((size_t)rows * cols, Editable);
+    clueNumbers.assign((size_t)rows * cols, 0);
 
     for (int i = 0; i < rows; ++i) {
         if (!std::getline(in, line))
@@ -51,154 +166,430 @@ bool CrosswordGrid::loadFromFile(const std::string& path) {
         if ((int)line.size() < cols) line += std::string(cols - line.size(), ' ');
         for (int j = 0; j < cols; ++j) {
             char ch = line[j];
+            int cell = index(i, j);
             if (ch == '.') {
-                grid[i][j].isBlocked = true;
-                grid[i][j].isEditable = false;
-                grid[i][j].letter = ' ';
-            } else if (ch == ' ' || ch == '_') {
-                grid[i][j].isBlocked = false;
-                grid[i][j].isEditable = true;
-                grid[i][j].letter = ' ';
-            } else {
-                grid[i][j].isBlocked = false;
-                grid[i][j].isEditable = false;
-                grid[i][j].letter = ch;
-            }
-        }
-    }
-
-    // compute clue numbers
-    int nextNumber = 1;
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            clueNumbers[i][j] = 0;
-            if (grid[i][j].isBlocked) continue;
-            bool startsAcross = (j == 0) || grid[i][j-1].isBlocked;
-            bool startsDown = (i == 0) || grid[i-1][j].isBlocked;
-            if (startsAcross || startsDown) {
-                clueNumbers[i][j] = nextNumber++;
+                flags[cell] = Blocked;
+            } else if (ch != ' ' && ch != '_') {
+                flags[cell] = 0;
+                letters[cell] = ch;
             }
         }
     }
 
+    recomputeClueNumbers();
+    buildSlots();
     return true;
 }
 
 bool CrosswordGrid::saveToFile(const std::string& path) const {
+    if (isBinaryPuzzle(path)) return saveBinary(path);
     std::ofstream out(path);
     if (!out) return false;
     out << rows << " " << cols << '\n';
     for (int i = 0; i < rows; ++i) {
         for (int j = 0; j < cols; ++j) {
-            if (grid[i][j].isBlocked) out << '.';
-            else if (grid[i][j].letter != ' ') out << grid[i][j].letter;
-            else out << ' ';
+            int cell = index(i, j);
+            if (flags[cell] & Blocked) out << '.';
+            else out << letters[cell];
         }
         out << '\n';
     }
     return true;
 }
 
-int CrosswordGrid::getClueNumber(int r, int c) const {
-    if (!inBounds(r, c)) return 0;
-    return clueNumbers[r][c];
+bool CrosswordGrid::readPuzzleInfo(const std::string& path, PuzzleInfo& info) {
+    std::ifstream in(path, std::ios::binary);
+    PuzzleHeader h;
+    if (!in || !readHeader(in, h)) return false;
+    info.rows = (int)h.rows;
+    info.cols = (int)h.cols;
+    info.openCells = (int)h.openCells;
+    info.slotCount = (int)h.slotCount;
+    info.hasLetters = (h.flags & PuzzleHasLetters) != 0;
+    return true;
 }
 
-void CrosswordGrid::randomizeBlockedCells(double blockDensity) {
-    // Clamp density to [0, 1]
-    if (blockDensity < 0.0) blockDensity = 0.0;
-    if (blockDensity > 1.0) blockDensity = 1.0;
+bool CrosswordGrid::loadBinary(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    PuzzleHeader h;
+    if (!in || !readHeader(in, h)) return false;
+    // one spare byte so the letter decoder can always read two bytes
+    std::vector<unsigned char> body((size_t)bodySize(h) + 1, 0);
+    if (!in.read(reinterpret_cast<char*>(body.data()), (std::streamsize)(body.size() - 1)) ||
+        checksum(body.data(), body.size() - 1) != h.checksum)
+        return false;
 
-    // Seed random number generator
-    std::mt19937 gen(static_cast<unsigned>(std::time(nullptr)));
-    std::uniform_real_distribution<> dis(0.0, 1.0);
+    // decode into a fresh grid and take it over only once every check has passed
+    CrosswordGrid g((int)h.rows, (int)h.cols);
+    const int n = g.rows * g.cols;
+    const size_t mapBytes = (size_t)bitmapBytes(h);
+    const unsigned char* blockedBits = body.data();
+    const unsigned char* givenBits = blockedBits + mapBytes;
+    const unsigned char* numberedBits = givenBits + mapBytes;
+    const unsigned char* table = numberedBits + mapBytes;
+    const unsigned char* letterData = table + h.slotBytes;
+    const bool hasLetters = (h.flags & PuzzleHasLetters) != 0, raw = (h.flags & PuzzleRawLetters) != 0;
+    static const char Alphabet[33] = " ABCDEFGHIJKLMNOPQRSTUVWXYZ?????";
+    // through local pointers: stores through uint8_t may alias the grid, so writing via the
+    // members would reload the vectors' data pointers after every cell
+    uint8_t* cellFlags = g.flags.data();
+    char* cellLetters = g.letters.data();
+    int* numbers = g.clueNumbers.data();
 
-    // Randomize each cell
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            if (dis(gen) < blockDensity) {
-                grid[i][j].isBlocked = true;
-                grid[i][j].isEditable = false;
-                grid[i][j].letter = ' ';
-            } else {
-                grid[i][j].isBlocked = false;
-                grid[i][j].isEditable = true;
-                grid[i][j].letter = ' ';
+    // eight cells per bitmap byte; the bits past the last cell must be clear
+    uint32_t open = 0;
+    int number = 1;
+    unsigned badCodes = 0;
+    for (size_t byte = 0; byte < mapBytes; ++byte) {
+        const int base = (int)byte * 8, count = std::min(8, n - base);
+        const unsigned valid = (1u << count) - 1;
+        const unsigned blocked = blockedBits[byte], given = givenBits[byte], numbered = numberedBits[byte];
+        if ((blocked | given | numbered) & ~valid || (given | numbered) & blocked) return false;
+        const unsigned editable = ~(blocked | given) & valid;
+        for (int bit = 0; bit < count; ++bit)
+            cellFlags[base + bit] = (uint8_t)(((blocked >> bit) & 1) * Blocked | ((editable >> bit) & 1) * Editable);
+        for (unsigned m = numbered; m; m &= m - 1) numbers[base + lowestBit(m)] = number++;
+        unsigned openCells = ~blocked & valid;
+        if (!hasLetters) {
+            open += (uint32_t)popcount(openCells);
+            continue;
+        }
+        for (unsigned m = openCells; m; m &= m - 1, ++open) {
+            if (open == h.openCells) return false;
+            int cell = base + lowestBit(m);
+            if (raw) {
+                cellLetters[cell] = (char)letterData[open];
+                continue;
             }
+            size_t at = (size_t)open * 5;
+            unsigned code = ((unsigned)letterData[at >> 3] | (unsigned)letterData[(at >> 3) + 1] << 8) >> (at & 7) & 31;
+            badCodes |= code > 26;
+            cellLetters[cell] = Alphabet[code];
         }
     }
+    if (open != h.openCells || badCodes) return false;
 
-    // Recompute clue numbers
-    recomputeClueNumbers();
+    // the slots as buildSlots would make them, without scanning the lines
+    g.slots.reserve(h.slotCount);
+    g.cellSlots.assign(n, CellSlots());
+    CellSlots* through = g.cellSlots.data();
+    const int width = g.cols;
+    const unsigned char* p = table;
+    uint64_t line = 0, offset = 0; // of the next free position in the current direction
+    for (uint32_t s = 0; s < h.slotCount; ++s) {
+        const bool across = s < h.acrossSlots;
+        if (s == h.acrossSlots) line = offset = 0;
+        const uint64_t lineLength = across ? g.cols : g.rows, lines = across ? g.rows : g.cols;
+        uint64_t code, length, extra = 0;
+        if (!getVarint(p, letterData, code)) return false;
+        length = code & 15;
+        if (length == 15 && (!getVarint(p, letterData, extra) || extra > PuzzleMaxSide)) return false;
+        length += extra;
+        offset += code >> 4;
+        if (offset >= lineLength) { // only divide when the slot is on a later line
+            line += offset / lineLength;
+            offset %= lineLength;
+        }
+        if (length < 2 || line >= lines || length > lineLength - offset) return false;
+        // a slot is a whole run: the edge or a block on both ends
+        const int first = (int)(across ? line * width + offset : offset * width + line), step = across ? 1 : width;
+        if ((offset > 0 && !(cellFlags[first - step] & Blocked)) ||
+            (offset + length < lineLength && !(cellFlags[first + (int)length * step] & Blocked)))
+            return false;
+        WordSlot& ws = g.slots.emplace_back();
+        ws.r = (int)(across ? line : offset);
+        ws.c = (int)(across ? offset : line);
+        ws.length = (int)length;
+        ws.across = across;
+        const int id = (int)s;
+        for (int k = 0; k < ws.length; ++k) {
+            int cell = first + k * step;
+            if (cellFlags[cell] & Blocked) return false;
+            CellSlots& at = through[cell];
+            if (across) { at.across = id; at.acrossPos = k; }
+            else { at.down = id; at.downPos = k; }
+        }
+        ws.clueNumber = numbers[first];
+        ws.word.assign(ws.length, ' ');
+        offset += length;
+    }
+    if (p != letterData) return false;
+
+    // numbers and slots must be what recomputeClueNumbers and buildSlots make of the blocks.
+    // Slots in one direction cannot overlap and each is a whole run, so that holds when an
+    // open cell has a slot in a direction exactly when it has an open neighbour along it, and
+    // a number exactly when it has no open cell above or to its left
+    for (int cell = 0; cell < n; ++cell) {
+        if (cellFlags[cell] & Blocked) continue;
+        const int c = cell % width;
+        const bool left = c > 0 && !(cellFlags[cell - 1] & Blocked);
+        const bool right = c + 1 < width && !(cellFlags[cell + 1] & Blocked);
+        const bool up = cell >= width && !(cellFlags[cell - width] & Blocked);
+        const bool down = cell + width < n && !(cellFlags[cell + width] & Blocked);
+        const CellSlots& at = through[cell];
+        if ((numbers[cell] != 0) == (left && up) || (at.across >= 0) != (left || right) || (at.down >= 0) != (up || down))
+            return false;
+    }
+
+    rows = g.rows;
+    cols = g.cols;
+    letters.swap(g.letters);
+    flags.swap(g.flags);
+    clueNumbers.swap(g.clueNumbers);
+    slots.swap(g.slots);
+    cellSlots.swap(g.cellSlots);
+    trail.clear();
+    return true;
 }
 
-void CrosswordGrid::recomputeClueNumbers() {
-    // Clear all clue numbers
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            clueNumbers[i][j] = 0;
+bool CrosswordGrid::saveBinary(const std::string& path) const {
+    if (rows <= 0 || cols <= 0 || (uint32_t)rows > PuzzleMaxSide || (uint32_t)cols > PuzzleMaxSide) return false;
+    const int n = rows * cols;
+    PuzzleHeader h;
+    std::memcpy(h.magic, PuzzleMagic, sizeof(h.magic));
+    h.version = PuzzleVersion;
+    h.byteOrder = PuzzleByteOrder;
+    h.rows = (uint32_t)rows;
+    h.cols = (uint32_t)cols;
+    h.flags = 0;
+    h.openCells = 0;
+    h.slotCount = 0;
+    h.reserved = 0;
+
+    const size_t mapBytes = (size_t)bitmapBytes(h);
+    std::vector<unsigned char> body(3 * mapBytes, 0);
+    for (int cell = 0; cell < n; ++cell) {
+        unsigned char bit = (unsigned char)(1u << (cell & 7));
+        if (flags[cell] & Blocked) {
+            body[cell >> 3] |= bit;
+            continue;
         }
+        if (!(flags[cell] & Editable)) body[mapBytes + (cell >> 3)] |= bit;
+        if (startsNumber(cell)) body[2 * mapBytes + (cell >> 3)] |= bit;
+        char ch = letters[cell];
+        if (ch != ' ') h.flags |= PuzzleHasLetters;
+        if (ch != ' ' && (ch < 'A' || ch > 'Z')) h.flags |= PuzzleRawLetters;
+        ++h.openCells;
     }
 
-    // Assign new clue numbers
-    int nextNumber = 1;
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            if (grid[i][j].isBlocked) continue;
-            bool startsAcross = (j == 0) || grid[i][j-1].isBlocked;
-            bool startsDown = (i == 0) || grid[i-1][j].isBlocked;
-            if (startsAcross || startsDown) {
-                clueNumbers[i][j] = nextNumber++;
+    // the slot table is scanned from the blocks rather than copied from slots, which
+    // setBlocked leaves stale
+    for (int dir = 0; dir < 2; ++dir) {
+        bool across = dir == 0;
+        if (!across) h.acrossSlots = h.slotCount;
+        const int lines = across ? rows : cols, lineLength = across ? cols : rows;
+        uint64_t end = 0; // position after the previous slot
+        for (int line = 0; line < lines; ++line) {
+            int run = 0;
+            for (int i = 0; i <= lineLength; ++i) {
+                int cell = across ? line * cols + i : i * cols + line;
+                if (i < lineLength && !(flags[cell] & Blocked)) { ++run; continue; }
+                if (run >= 2) {
+                    uint64_t start = (uint64_t)line * lineLength + i - run;
+                    putVarint(body, (start - end) << 4 | (uint64_t)std::min(run, 15));
+                    if (run >= 15) putVarint(body, (uint64_t)(run - 15));
+                    end = start + (uint64_t)run;
+                    ++h.slotCount;
+                }
+                run = 0;
             }
         }
     }
-}
+    h.slotBytes = (uint32_t)(body.size() - 3 * mapBytes);
 
-void CrosswordGrid::buildSlots() {
-    slots.clear();
-    // across slots
-    for (int i = 0; i < rows; ++i) {
-        int j = 0;
-        while (j < cols) {
-            while (j < cols && grid[i][j].isBlocked) ++j;
-            int start = j;
-            while (j < cols && !grid[i][j].isBlocked) ++j;
-            int len = j - start;
-            if (len >= 2) {
-                WordSlot ws; ws.r = i; ws.c = start; ws.length = len; ws.across = true; ws.word = std::string(len, ' ');
-                ws.clueNumber = clueNumbers[i][start];
-                slots.push_back(ws);
+    if (h.flags & PuzzleHasLetters) {
+        size_t base = body.size(), at = 0;
+        if (!(h.flags & PuzzleRawLetters)) body.resize(base + ((size_t)h.openCells * 5 + 7) / 8, 0);
+        for (int cell = 0; cell < n; ++cell) {
+            if (flags[cell] & Blocked) continue;
+            char ch = letters[cell];
+            if (h.flags & PuzzleRawLetters) {
+                body.push_back((unsigned char)ch);
+                continue;
             }
+            unsigned code = ch == ' ' ? 0 : (unsigned)(ch - 'A' + 1);
+            body[base + (at >> 3)] |= (unsigned char)(code << (at & 7));
+            if ((at & 7) > 3) body[base + (at >> 3) + 1] |= (unsigned char)(code >> (8 - (at & 7)));
+            at += 5;
         }
     }
+    h.checksum = checksum(body.data(), body.size());
 
-    // down slots
-    for (int j = 0; j < cols; ++j) {
-        int i = 0;
-        while (i < rows) {
-            while (i < rows && grid[i][j].isBlocked) ++i;
-            int start = i;
-            while (i < rows && !grid[i][j].isBlocked) ++i;
-            int len = i - start;
-            if (len >= 2) {
-                WordSlot ws; ws.r = start; ws.c = j; ws.length = len; ws.across = false; ws.word = std::string(len, ' ');
-                ws.clueNumber = clueNumbers[start][j];
-                slots.push_back(ws);
-            }
+    // write beside the target and rename over it, so a reader never sees a partial file
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(body.data()), (std::streamsize)body.size());
+    out.close();
+    std::error_code ec;
+    if (out) std::filesystem::rename(tmp, path, ec);
+    if (!out || ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+int CrosswordGrid::getClueNumber(int r, int c) const {
+    if (!inBounds(r, c)) return 0;
+    return clueNumbers[index(r, c)];
+}
+
+void CrosswordGrid::recomputeClueNumbers() {
+    // Clear all clue numbers
+    std::fill(clueNumbers.begin(), clueNumbers.end(), 0);
+
+    // Assign new clue numbers
+    int nextNumber = 1;
+    for (int cell = 0; cell < (int)clueNumbers.size(); ++cell)
+        if (startsNumber(cell)) clueNumbers[cell] = nextNumber++;
+}
+
+bool CrosswordGrid::startsNumber(int cell) const {
+    if (flags[cell] & Blocked) return false;
+    bool startsAcross = cell % cols == 0 || (flags[cell - 1] & Blocked);
+    bool startsDown = cell < cols || (flags[cell - cols] & Blocked);
+    return startsAcross || startsDown;
+}
+
+void CrosswordGrid::toggleBlock(int r, int c) {
+    if (!inBounds(r, c)) return;
+    setBlocked(r, c, !isBlocked(r, c));
+    if (cellSlots.size() != letters.size() || clueNumbers.size() != letters.size()) {
+        recomputeClueNumbers();
+        buildSlots();
+        return;
+    }
+    int first = index(r, c);
+    int end = renumberFrom(first);
+    rescanLine(r, true);
+    rescanLine(c, false);
+    // only slots starting where numbers were rewritten can have a new one
+    for (auto& s : slots) {
+        int start = index(s.r, s.c);
+        if (start >= first && start < end) s.clueNumber = clueNumbers[start];
+    }
+}
+
+int CrosswordGrid::renumberFrom(int first) {
+    // numbers before the changed cell stay; continue after the last of them
+    int next = 1;
+    for (int i = first - 1; i >= 0; --i) {
+        if (clueNumbers[i]) { next = clueNumbers[i] + 1; break; }
+    }
+    // the cell, its right and its lower neighbour are the only ones that can gain or lose a
+    // number; past them, once a number comes out as before, so does every later one
+    int last = first + cols;
+    int cell = first;
+    for (; cell < (int)clueNumbers.size(); ++cell) {
+        int number = startsNumber(cell) ? next++ : 0;
+        if (cell > last && number != 0 && number == clueNumbers[cell]) break;
+        clueNumbers[cell] = number;
+    }
+    return cell;
+}
+
+void CrosswordGrid::rescanLine(int line, bool across) {
+    // buildSlots order: across slots by row then column, then down slots by column then row
+    auto before = [&](const WordSlot& s) { return across ? (s.across && s.r < line) : (s.across || s.c < line); };
+    auto within = [&](const WordSlot& s) { return across ? (s.across && s.r <= line) : (s.across || s.c <= line); };
+    int lo = (int)(std::partition_point(slots.begin(), slots.end(), before) - slots.begin());
+    int hi = (int)(std::partition_point(slots.begin() + lo, slots.end(), within) - slots.begin());
+
+    const int count = across ? cols : rows;
+    auto cellAt = [&](int k) { return across ? index(line, k) : index(k, line); };
+    std::vector<WordSlot> runs;
+    for (int k = 0; k < count;) {
+        while (k < count && (flags[cellAt(k)] & Blocked)) ++k;
+        int start = k;
+        while (k < count && !(flags[cellAt(k)] & Blocked)) ++k;
+        if (k - start >= 2) {
+            WordSlot ws;
+            ws.r = across ? line : start;
+            ws.c = across ? start : line;
+            ws.length = k - start;
+            ws.across = across;
+            ws.clueNumber = clueNumbers[index(ws.r, ws.c)];
+            ws.word = std::string(ws.length, ' ');
+            runs.push_back(ws);
+        }
+    }
+
+    // forget the old runs of this line, shift the ids of every later slot, then record the new runs
+    for (int k = 0; k < count; ++k) {
+        CellSlots& at = cellSlots[cellAt(k)];
+        (across ? at.across : at.down) = -1;
+    }
+    int delta = (int)runs.size() - (hi - lo);
+    if (delta != 0) {
+        for (auto& at : cellSlots) {
+            if (at.across >= hi) at.across += delta;
+            if (at.down >= hi) at.down += delta;
+        }
+    }
+    // overwrite in place and only move the tail of slots when the count changed
+    int keep = std::min((int)runs.size(), hi - lo);
+    std::move(runs.begin(), runs.begin() + keep, slots.begin() + lo);
+    if (delta < 0) slots.erase(slots.begin() + lo + keep, slots.begin() + hi);
+    else slots.insert(slots.begin() + hi, runs.begin() + keep, runs.end());
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const WordSlot& s = slots[lo + i];
+        int start = across ? s.c : s.r;
+        for (int k = 0; k < s.length; ++k) {
+            CellSlots& at = cellSlots[cellAt(start + k)];
+            (across ? at.across : at.down) = lo + (int)i;
+            (across ? at.acrossPos : at.downPos) = k;
         }
     }
 }
 
+void CrosswordGrid::buildSlots() {
+    slots.clear();
+    cellSlots.assign(letters.size(), CellSlots());
+    // the run starts come from a bitboard of the open cells (fixed-size for the standard
+    // grid sizes); only the cells of actual slots are walked
+    withGridBits(rows, cols, [&](auto open) {
+        for (int cell = 0; cell < (int)flags.size(); ++cell)
+            if (!(flags[cell] & Blocked)) open.set(cell);
+        auto acrossStarts = open.acrossStarts(open.rowMasks(2));
+        auto downStarts = open.downStarts();
+        int acrossCount = acrossStarts.count();
+        slots.resize(acrossCount + downStarts.count());
+
+        auto place = [&](int id, int start, bool across) {
+            WordSlot& ws = slots[id];
+            ws.r = start / cols; ws.c = start % cols; ws.across = across;
+            ws.clueNumber = clueNumbers[start];
+            int step = across ? 1 : cols;
+            int end = across ? start - ws.c + cols : (int)letters.size();
+            int len = 0;
+            for (int cell = start; cell < end && open.test(cell); cell += step, ++len) {
+                CellSlots& at = cellSlots[cell];
+                (across ? at.across : at.down) = id;
+                (across ? at.acrossPos : at.downPos) = len;
+            }
+            ws.length = len;
+            ws.word.assign(len, ' ');
+        };
+        // across slots by row then column, which is bit order
+        int next = 0;
+        acrossStarts.forEach([&](int cell) { place(next++, cell, true); });
+        // down slots by column then row: bit order is row-major, so bucket the starts by
+        // column (rows stay in order within a bucket)
+        std::vector<int> column(cols + 1, 0);
+        downStarts.forEach([&](int cell) { ++column[cell % cols + 1]; });
+        column[0] = acrossCount;
+        for (int j = 1; j < cols; ++j) column[j] += column[j - 1];
+        downStarts.forEach([&](int cell) { place(column[cell % cols]++, cell, false); });
+    });
+}
+
 std::vector<int> CrosswordGrid::getSlotsForCell(int r, int c) const {
     std::vector<int> out;
-    for (size_t i = 0; i < slots.size(); ++i) {
-        const WordSlot& s = slots[i];
-        if (s.across) {
-            if (r == s.r && c >= s.c && c < s.c + s.length) out.push_back((int)i);
-        } else {
-            if (c == s.c && r >= s.r && r < s.r + s.length) out.push_back((int)i);
-        }
-    }
+    const CellSlots& at = slotsAt(r, c);
+    if (at.across >= 0) out.push_back(at.across);
+    if (at.down >= 0) out.push_back(at.down);
     return out;
 }
 
@@ -206,19 +597,17 @@ bool CrosswordGrid::placeWordInSlot(int slotIndex, const std::string& word) {
     if (slotIndex < 0 || slotIndex >= (int)slots.size()) return false;
     WordSlot& s = slots[slotIndex];
     if ((int)word.size() != s.length) return false;
+    SlotView view = slotLetters(s);
     // check conflicts
     for (int k = 0; k < s.length; ++k) {
-        int rr = s.r + (s.across ? 0 : k);
-        int cc = s.c + (s.across ? k : 0);
-        char existing = grid[rr][cc].letter;
+        char existing = view[k];
         if (existing != ' ' && existing != word[k]) return false;
     }
     // place
     for (int k = 0; k < s.length; ++k) {
-        int rr = s.r + (s.across ? 0 : k);
-        int cc = s.c + (s.across ? k : 0);
-        grid[rr][cc].letter = word[k];
-        grid[rr][cc].isEditable = false;
+        int cell = view.cell(k);
+        letters[cell] = word[k];
+        flags[cell] &= ~Editable;
     }
     s.word = word;
     return true;
@@ -226,5 +615,51 @@ bool CrosswordGrid::placeWordInSlot(int slotIndex, const std::string& word) {
 
 void CrosswordGrid::clearSlotAssignments() {
     for (auto &s : slots) s.word.clear();
-    for (int i = 0; i < rows; ++i) for (int j = 0; j < cols; ++j) if (!grid[i][j].isBlocked) { grid[i][j].letter = ' '; grid[i][j].isEditable = true; }
+    for (size_t i = 0; i < letters.size(); ++i) {
+        if (flags[i] & Blocked) continue;
+        letters[i] = ' ';
+        flags[i] = Editable;
+    }
+}
+
+bool CrosswordGrid::placeWordTrailed(int slotIndex, const std::string& word) {
+    if (slotIndex < 0 || slotIndex >= (int)slots.size()) return false;
+    const WordSlot& s = slots[slotIndex];
+    if ((int)word.size() != s.length) return false;
+    SlotView view = slotLetters(s);
+    for (int k = 0; k < s.length; ++k) {
+        char existing = view[k];
+        if (existing != ' ' && existing != word[k]) return false;
+    }
+    for (int k = 0; k < s.length; ++k) {
+        int cell = view.cell(k);
+        bool editable = (flags[cell] & Editable) != 0;
+        if (letters[cell] == word[k] && !editable) continue;
+        trail.push_back({cell, letters[cell], editable});
+        letters[cell] = word[k];
+        flags[cell] &= ~Editable;
+    }
+    return true;
+}
+
+void CrosswordGrid::rollback(size_t mark) {
+    while (trail.size() > mark) {
+        const TrailEntry& e = trail.back();
+        letters[e.cell] = e.letter;
+        if (e.editable) flags[e.cell] |= Editable;
+        else flags[e.cell] &= ~Editable;
+        trail.pop_back();
+    }
+}
+
+void CrosswordGrid::syncSlotWords() {
+    for (auto& s : slots) {
+        SlotView view = slotLetters(s);
+        s.word.assign(s.length, ' ');
+        for (int k = 0; k < s.length; ++k) {
+            char ch = view[k];
+            if (ch == ' ') { s.word.clear(); break; }
+            s.word[k] = ch;
+        }
+    }
 }
@@ -1,13 +1,18 @@
 #pragma once
 #include <vector>
 #include <string>
-#include "Cell.hpp"
+#include <cstdint>
 
 class CrosswordGrid {
 public:
     int rows, cols;
-    std::vector<std::vector<Cell>> grid;
-    std::vector<std::vector<int>> clueNumbers; // 0 means no number
+    // Cells are stored row-major in parallel arrays (cell index r * cols + c), so a scan of
+    // letters touches nothing else and a down slot is a fixed stride through one array.
+    static constexpr uint8_t Blocked = 1;
+    static constexpr uint8_t Editable = 2;
+    std::vector<char> letters;     // ' ' for empty
+    std::vector<uint8_t> flags;    // Blocked | Editable
+    std::vector<int> clueNumbers;  // 0 means no number
     struct WordSlot {
         int r = 0, c = 0; // start
         int length = 0;
@@ -18,36 +23,119 @@ public:
 
     std::vector<WordSlot> slots;
 
+    // The slots through every cell, filled by buildSlots: -1 where a cell has no slot in that
+    // direction (blocked, or in a run shorter than 2); pos is the cell's offset in the slot.
+    struct CellSlots {
+        int across = -1, down = -1;
+        int acrossPos = 0, downPos = 0;
+    };
+    std::vector<CellSlots> cellSlots; // row-major, like letters
+
+    // Undo trail used by search code: trailed placements push the previous state of every
+    // cell they change, and rollback(mark) restores everything pushed after mark.
+    struct TrailEntry {
+        int cell;
+        char letter;
+        bool editable;
+    };
+    std::vector<TrailEntry> trail;
+
     CrosswordGrid(int r, int c);
 
-    void setLetter(int r, int c, char letter);
-    char getLetter(int r, int c) const;
-    bool isBlocked(int r, int c) const;
+    int index(int r, int c) const { return r * cols + c; }
+    void setLetter(int r, int c, char letter) {
+        int i = index(r, c);
+        if ((flags[i] & (Blocked | Editable)) == Editable) letters[i] = letter;
+    }
+    char getLetter(int r, int c) const { return letters[index(r, c)]; }
+    bool isBlocked(int r, int c) const { return (flags[index(r, c)] & Blocked) != 0; }
+    bool isEditable(int r, int c) const { return (flags[index(r, c)] & Editable) != 0; }
+    // Block or open a cell; either way its letter is cleared and an open cell is editable.
+    // Clue numbers and slots are not updated.
+    void setBlocked(int r, int c, bool blocked);
+    // Flip a cell between blocked and open and bring clue numbers, slots and cellSlots up to
+    // date in place: only the runs of its row and column are rescanned, and numbering
+    // restarts at the cell. Same numbers, slots and ids as setBlocked + recomputeClueNumbers
+    // + buildSlots (which it falls back to if slots were never built for this grid), except
+    // that slots away from the cell keep their word.
+    void toggleBlock(int r, int c);
 
     // Helpers
-    bool inBounds(int r, int c) const;
+    bool inBounds(int r, int c) const { return r >= 0 && r < rows && c >= 0 && c < cols; }
 
-    // Load/save simple puzzle format (rows cols, then rows lines with '.' for blocked,
-    // uppercase letters or ' ' for empty)
+    // Load/save a puzzle. Paths ending in ".cwp" use the binary format below; anything else
+    // the simple text format (rows cols, then rows lines with '.' for blocked, uppercase
+    // letters or ' ' for empty). Clue numbers and slots are up to date after a load.
     bool loadFromFile(const std::string& path);
     bool saveToFile(const std::string& path) const;
 
+    // Binary puzzle (.cwp): a fixed header, then bitmaps of the blocked, given (not editable)
+    // and numbered cells, the slot table in buildSlots order and, if any cell is filled in,
+    // the letters of the open cells (the solution of a generated puzzle). A checksum covers
+    // everything after the header. Unlike the text format it keeps which letters are
+    // editable, and loading it skips the numbering and the slot scan.
+    struct PuzzleInfo {
+        int rows = 0, cols = 0;
+        int openCells = 0;
+        int slotCount = 0;
+        bool hasLetters = false;
+    };
+    static bool isBinaryPuzzle(const std::string& path); // by extension
+    // Validate a binary puzzle by its header and file size only; no cell is read
+    static bool readPuzzleInfo(const std::string& path, PuzzleInfo& info);
+    // Also checks the checksum, and that the numbered cells and the slot table are the ones
+    // the blocks give; the grid is left as it was if any check fails
+    bool loadBinary(const std::string& path);
+    bool saveBinary(const std::string& path) const;
+
     // Get the clue number for a cell (0 if none). Numbers are assigned according to
     // standard crossword rules: a cell gets a number if it's not blocked and (cell above
     // is blocked or cell to the left is blocked).
     int getClueNumber(int r, int c) const;
 
-    // Randomize blocked cells with optional density (0.0 to 1.0, default 0.2 = 20%)
-    // Also resets all letters to empty
-    void randomizeBlockedCells(double blockDensity = 0.2);
-
     // Recompute clue numbers after grid changes
     void recomputeClueNumbers();
 
+    // The letters of a slot read in place: view[k] is its k-th letter, one fixed stride
+    // apart (1 across, cols down). Valid until the grid is resized or reloaded.
+    struct SlotView {
+        const char* first;
+        int start;  // cell index of the first letter
+        int step;
+        int length;
+        char operator[](int k) const { return first[k * step]; }
+        int cell(int k) const { return start + k * step; }
+    };
+    SlotView slotLetters(const WordSlot& s) const {
+        int start = index(s.r, s.c);
+        return {letters.data() + start, start, s.across ? 1 : cols, s.length};
+    }
+    SlotView slotLetters(int slotIndex) const { return slotLetters(slots[slotIndex]); }
+
     // Slot helpers
     void buildSlots();
     const std::vector<WordSlot>& getSlots() const { return slots; }
-    std::vector<int> getSlotsForCell(int r, int c) const;
+    // Constant time and no allocation; all -1 if slots were built for another size
+    const CellSlots& slotsAt(int r, int c) const {
+        static const CellSlots none;
+        int i = index(r, c);
+        return inBounds(r, c) && (size_t)i < cellSlots.size() ? cellSlots[i] : none;
+    }
+    std::vector<int> getSlotsForCell(int r, int c) const; // slotsAt as a list, across first
     bool placeWordInSlot(int slotIndex, const std::string& word);
     void clearSlotAssignments();
+
+    // Like placeWordInSlot, but records changed cells on the trail and leaves slot words
+    // alone (call syncSlotWords once the search is done). Does not allocate once the
+    // trail has been reserved.
+    bool placeWordTrailed(int slotIndex, const std::string& word);
+    size_t trailMark() const { return trail.size(); }
+    void rollback(size_t mark);
+    // Set every slot's word from the letters in the grid (empty if not completely filled)
+    void syncSlotWords();
+
+private:
+    bool startsNumber(int cell) const; // open, with a block or the edge above or to the left
+    int renumberFrom(int cell); // returns the end of the renumbered cells
+    void rescanLine(int line, bool across); // replace the slots of one row or column
 };
@@ -0,0 +1,111 @@
+#include "DictionaryLoader.hpp"
+#include <algorithm>
+
+DictionaryLoader::~DictionaryLoader() {
+    join();
+}
+
+void DictionaryLoader::join() {
+    if (worker.joinable()) worker.join();
+}
+
+std::vector<std::filesystem::file_time_type> DictionaryLoader::stampsOf(const std::vector<std::string>& paths) {
+    std::vector<std::filesystem::file_time_type> out;
+    for (const auto& path : paths) {
+        std::error_code ec;
+        auto t = std::filesystem::last_write_time(path, ec);
+        out.push_back(ec ? std::filesystem::file_time_type::min() : t);
+    }
+    return out;
+}
+
+bool DictionaryLoader::start(std::vector<std::string> paths) {
+    State s = state();
+    if (s == State::Loading || s == State::Indexing) return false;
+    join();
+    // stamp before reading, so a write during the build triggers another reload
+    std::vector<std::filesystem::file_time_type> when = stampsOf(paths);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stamps = when;
+        sources = paths;
+        started = std::chrono::steady_clock::now();
+        finishedAfter = -1.0;
+    }
+    words = 0;
+    status = static_cast<int>(State::Loading);
+    unsigned version = ++builds;
+
+    worker = std::thread([this, paths = std::move(paths), when = std::move(when), version]() {
+        auto trie = std::make_shared<Trie>();
+        std::string from, stale;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            const std::string& path = paths[i];
+            bool image = path.size() > 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+            if (image && std::any_of(when.begin() + i + 1, when.end(), [&](auto t) { return t > when[i]; })) {
+                stale = path;
+                continue;
+            }
+            if (image ? trie->mapImage(path) : trie->loadFromFile(path, true)) {
+                from = path;
+                break;
+            }
+        }
+        if (from.empty()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finishedAfter = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            status = static_cast<int>(State::Failed);
+            return;
+        }
+
+        std::vector<std::string> list = trie->allWords();
+        words = list.size();
+        status = static_cast<int>(State::Indexing);
+        auto index = std::make_shared<WordIndex>();
+        index->build(list);
+
+        auto snap = std::make_unique<Snapshot>();
+        snap->trie = std::move(trie);
+        snap->index = std::move(index);
+        snap->source = from;
+        snap->staleImage = stale;
+        snap->words = list.size();
+        snap->version = version;
+        // the old snapshot stays alive in snapshots until releaseRetired
+        std::lock_guard<std::mutex> lock(mutex);
+        published.store(snap.get(), std::memory_order_release);
+        snapshots.push_back(std::move(snap));
+        finishedAfter = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        status = static_cast<int>(State::Ready);
+    });
+    return true;
+}
+
+bool DictionaryLoader::reload() {
+    std::vector<std::string> paths;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        paths = sources;
+    }
+    if (paths.empty()) return false;
+    return start(std::move(paths));
+}
+
+void DictionaryLoader::releaseRetired() {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Snapshot* live = published.load(std::memory_order_relaxed);
+    snapshots.erase(std::remove_if(snapshots.begin(), snapshots.end(), [&](const auto& s) { return s.get() != live; }),
+                    snapshots.end());
+}
+
+bool DictionaryLoader::changedOnDisk() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !sources.empty() && stampsOf(sources) != stamps;
+}
+
+double DictionaryLoader::elapsedSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (finishedAfter >= 0.0) return finishedAfter;
+    if (state() == State::Idle) return 0.0;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
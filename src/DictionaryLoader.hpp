@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trie.hpp"
+#include "WordIndex.hpp"
+
+// Builds the dictionary on a worker thread so the window opens at once: the word graph for
+// hints and the WordIndex the generator searches. Each finished build is published as an
+// immutable Snapshot by storing its address in an atomic pointer, so current() is a single
+// lock-free load. The loader owns every snapshot it published: a pointer from current()
+// stays valid until releaseRetired() frees the replaced ones, and work that outlives that
+// (a fill on another thread) copies the trie or index shared_ptr it needs. A reload never
+// changes the dictionary under a running search. The destructor waits for a build that is
+// still running.
+class DictionaryLoader {
+public:
+    enum class State { Idle, Loading, Indexing, Ready, Failed };
+
+    struct Snapshot {
+        std::shared_ptr<const Trie> trie;
+        std::shared_ptr<const WordIndex> index;
+        std::string source; // the path that loaded
+        std::string staleImage; // an image skipped because a word list after it is newer
+        size_t words = 0;
+        unsigned version = 0; // 1 for the first load, +1 per reload
+    };
+
+    DictionaryLoader() = default;
+    ~DictionaryLoader();
+    DictionaryLoader(const DictionaryLoader&) = delete;
+    DictionaryLoader& operator=(const DictionaryLoader&) = delete;
+
+    // Try paths in order: "*.bin" files are mapped as Trie images, anything else is read as
+    // a word list. An image older than a word list later in the list is skipped, so editing
+    // the text file takes effect before the image is recompiled. Returns false if a build is
+    // already running.
+    bool start(std::vector<std::string> paths);
+    // Rebuild from the same paths; the current snapshot stays published until the new one
+    // is ready, and is kept if the rebuild fails.
+    bool reload();
+    // True if any path changed on disk (written, created or removed) since the last build
+    // started. Cheap enough to poll every second or so.
+    bool changedOnDisk() const;
+
+    State state() const { return static_cast<State>(status.load()); }
+    size_t wordCount() const { return words.load(); } // of the build in progress or last done
+    double elapsedSeconds() const;
+
+    // Null until the first build succeeds. Never blocks on a running build.
+    const Snapshot* current() const { return published.load(std::memory_order_acquire); }
+    // Free the snapshots a newer one replaced. Call it only where no pointer from an earlier
+    // current() is still in use, e.g. from the one thread that reads them, between queries.
+    void releaseRetired();
+
+private:
+    std::thread worker;
+    std::atomic<int> status{static_cast<int>(State::Idle)};
+    std::atomic<size_t> words{0};
+    std::atomic<const Snapshot*> published{nullptr};
+    unsigned builds = 0;
+
+    mutable std::mutex mutex; // guards the fields below (not published, which readers load freely)
+    std::vector<std::unique_ptr<const Snapshot>> snapshots; // every one published and not yet released
+    std::vector<std::string> sources;
+    std::vector<std::filesystem::file_time_type> stamps; // per source, min() if missing
+    std::chrono::steady_clock::time_point started;
+    double finishedAfter = -1.0; // seconds, once the build ended
+
+    void join();
+    static std::vector<std::filesystem::file_time_type> stampsOf(const std::vector<std::string>& paths);
+};
@@ -29,6 +29,10 @@ GUI::GUI(CrosswordGrid& g)
     quitButton.setSize(sf::Vector2f(200.f, 50.f));
     quitButton.setPosition(sf::Vector2f(200.f, 400.f));
     quitButton.setFillColor(sf::Color::Red);
+
+    // A compiled image (crossword_batch --compile-dict) maps almost instantly; the word list
+    // is the fallback. Either way the window is up before the dictionary is.
+    dictLoader.start({"assets/dictionary.bin", "assets/dictionary.txt"});
 }
 
 void GUI::run() {
@@ -75,6 +79,9 @@ void GUI::run() {
             }
         }
 
+        updateDictionary();
+        updateGeneration();
+
         window.clear(sf::Color::White);
 
         if (gameState == GameState::Menu) {
@@ -84,10 +91,12 @@ void GUI::run() {
         } else if (gameState == GameState::Playing) {
             drawGrid();
             drawCluePanel();
+            drawGenerationStatus();
             if (showHelp) drawHelpPanel();
         } else if (gameState == GameState::Quit) {
             window.close();
         }
+        drawDictionaryStatus();
 
         window.display();
     }
@@ -96,6 +105,11 @@ void GUI::run() {
 void GUI::drawGrid() {
     const int gridW = grid.cols * cellSize;
     const int gridH = grid.rows * cellSize;
+    std::vector<char> partial;
+    if (asyncGen.running()) {
+        Generator::Progress p = asyncGen.progress();
+        if (p.rows == grid.rows && p.cols == grid.cols) partial = std::move(p.bestLetters);
+    }
     for (int r = 0; r < grid.rows; r++) {
         for (int c = 0; c < grid.cols; c++) {
 
@@ -117,6 +131,16 @@ void GUI::drawGrid() {
 
             if (!grid.isBlocked(r, c)) {
                 char letter = grid.getLetter(r, c);
+                if (letter == ' ' && fontLoaded && asyncGen.running() && !partial.empty()) {
+                    // deepest partial fill of the running generator, greyed out
+                    char p = partial[(size_t)r * grid.cols + c];
+                    if (p != ' ') {
+                        sf::Text text(font, std::string(1, p), 24u);
+                        text.setFillColor(sf::Color(150, 150, 150));
+                        text.setPosition(sf::Vector2f(static_cast<float>(c * cellSize + 10), static_cast<float>(r * cellSize + 5)));
+                        window.draw(text);
+                    }
+                }
                 if (letter != ' ' && fontLoaded) {
                     sf::Text text(font, std::string(1, letter), 24u);
                     text.setFillColor(sf::Color::Black);
@@ -140,8 +164,9 @@ void GUI::drawGrid() {
 
     // highlight full words for selection
     if (selectedRow != -1 && selectedCol != -1) {
-        auto slotIds = grid.getSlotsForCell(selectedRow, selectedCol);
-        for (int sid : slotIds) {
+        const CrosswordGrid::CellSlots& at = grid.slotsAt(selectedRow, selectedCol);
+        for (int sid : {at.across, at.down}) {
+            if (sid < 0) continue;
             const auto& s = grid.getSlots()[sid];
             sf::RectangleShape highlight(sf::Vector2f(static_cast<float>(s.across ? s.length * cellSize : cellSize), static_cast<float>(s.across ? cellSize : s.length * cellSize)));
             highlight.setPosition(sf::Vector2f(static_cast<float>(s.c * cellSize), static_cast<float>(s.r * cellSize)));
@@ -165,6 +190,7 @@ void GUI::handleMouseClick(int x, int y) {
 
 void GUI::handleTextEntered(char32_t unicode) {
     if (selectedRow == -1 || selectedCol == -1) return;
+    if (asyncGen.running()) return;
     if (unicode < 128) {
         char c = static_cast<char>(unicode);
         if (std::isalpha(static_cast<unsigned char>(c))) {
@@ -183,6 +209,12 @@ void GUI::handleKeyPress(const sf::Event::KeyPressed& key) {
     // Toggle help: ? or / key
     if (key.code == sf::Keyboard::Key::Slash) { showHelp = !showHelp; return; }
 
+    // While a fill is running the grid belongs to it; Esc cancels
+    if (asyncGen.running()) {
+        if (key.code == sf::Keyboard::Key::Escape) asyncGen.cancel();
+        return;
+    }
+
     // Undo/redo: Ctrl+Z / Ctrl+Y
     if (key.control && key.code == sf::Keyboard::Key::Z) {
         if (history.canUndo()) {
@@ -202,16 +234,22 @@ void GUI::handleKeyPress(const sf::Event::KeyPressed& key) {
     // Save/load
     if (key.control && key.code == sf::Keyboard::Key::S) { saveAuto(); return; }
     if (key.control && key.code == sf::Keyboard::Key::L) { loadAuto(); return; }
+    // Template editing: block or open the selected cell (numbers and slots follow)
+    if (key.control && key.code == sf::Keyboard::Key::B) {
+        if (selectedRow != -1 && selectedCol != -1) grid.toggleBlock(selectedRow, selectedCol);
+        return;
+    }
+    if (key.control && key.code == sf::Keyboard::Key::R) {
+        if (dictLoader.reload()) std::cerr << "Reloading dictionary..." << std::endl;
+        return;
+    }
 
     // Hint
     if (key.code == sf::Keyboard::Key::H) { provideHint(); return; }
 
     // Try generator (G) if dictionary loaded
     if (key.code == sf::Keyboard::Key::Z) {
-        std::vector<std::string> pool = {"HELLO","WORLD","CROSS","WORDS","PUZZLE","GRID","STACK","QUEUE","TREE","GRAPH","ARRAY","VECTOR"};
-        grid.clearSlotAssignments();
-        grid.buildSlots();
-        generator.generate(grid, pool);
+        startGeneration();
         return;
     }
 
@@ -322,12 +360,8 @@ void GUI::drawCluePanel() {
         std::string dir = s.across ? "A" : "D";
         std::string display = std::to_string(s.clueNumber) + dir + ": ";
         // build current pattern
-        for (int k = 0; k < s.length; ++k) {
-            int rr = s.r + (s.across ? 0 : k);
-            int cc = s.c + (s.across ? k : 0);
-            char ch = grid.getLetter(rr, cc);
-            display.push_back(ch == ' ' ? '_' : ch);
-        }
+        CrosswordGrid::SlotView view = grid.slotLetters(s);
+        for (int k = 0; k < view.length; ++k) display.push_back(view[k] == ' ' ? '_' : view[k]);
 
         sf::Text t(font, display, 14u);
         t.setFillColor(sf::Color::Black);
@@ -348,8 +382,6 @@ void GUI::saveAuto() {
 
 void GUI::loadAuto() {
     if (grid.loadFromFile("autosave.txt")) {
-        grid.recomputeClueNumbers();
-        grid.buildSlots();
         std::cerr << "Loaded autosave.txt" << std::endl;
     } else {
         std::cerr << "Failed to load autosave.txt" << std::endl;
@@ -358,22 +390,23 @@ void GUI::loadAuto() {
 
 void GUI::provideHint() {
     if (selectedRow == -1 || selectedCol == -1) return;
-    auto slotIds = grid.getSlotsForCell(selectedRow, selectedCol);
-    if (slotIds.empty()) return;
-    int sid = slotIds[0];
-    const auto &s = grid.getSlots()[sid];
+    const CrosswordGrid::CellSlots& at = grid.slotsAt(selectedRow, selectedCol);
+    if (at.across < 0 && at.down < 0) return;
+    int sid = at.across >= 0 ? at.across : at.down;
+    int posInSlot = at.across >= 0 ? at.acrossPos : at.downPos;
     // build pattern
     std::string pattern;
-    int posInSlot = -1;
-    for (int k = 0; k < s.length; ++k) {
-        int rr = s.r + (s.across ? 0 : k);
-        int cc = s.c + (s.across ? k : 0);
-        char ch = grid.getLetter(rr, cc);
-        pattern.push_back(ch == ' ' ? '_' : ch);
-        if (rr == selectedRow && cc == selectedCol) posInSlot = k;
-    }
+    CrosswordGrid::SlotView view = grid.slotLetters(sid);
+    for (int k = 0; k < view.length; ++k) pattern.push_back(view[k] == ' ' ? '_' : view[k]);
 
-    auto cand = dict.collectWithPattern(pattern);
+    auto dict = dictLoader.current();
+    if (!dict) {
+        std::cerr << (dictFailed ? "No hints available (no dictionary loaded)." : "Dictionary still loading...") << std::endl;
+        return;
+    }
+    // two candidates are enough to tell "exactly one" from "several"; best-scored first so
+    // the revealed letter comes from the most likely fill
+    auto cand = dict->trie->topKWithPattern(pattern, 2);
     if (cand.empty()) {
         // no dictionary matches; reveal a letter at selected cell if any common letter in pool fallback
         // reveal nothing
@@ -453,8 +486,6 @@ void GUI::handlePuzzleSelectClick(int x, int y) {
 void GUI::loadPuzzleByIndex(int index) {
     std::string path = puzzleBrowser.getFullPath(index);
     if (!path.empty() && grid.loadFromFile(path)) {
-        grid.recomputeClueNumbers();
-        grid.buildSlots();
         selectedRow = -1;
         selectedCol = -1;
         history.clear();
@@ -492,8 +523,10 @@ void GUI::drawHelpPanel() {
         {"Ctrl+Y", "Redo last letter"},
         {"Ctrl+S", "Save to autosave.txt"},
         {"Ctrl+L", "Load from autosave.txt"},
+        {"Ctrl+R", "Reload dictionary"},
+        {"Ctrl+B", "Block/open selected cell"},
         {"H", "Hint for selected cell"},
-        {"Z", "Clear puzzle"},
+        {"Z", "Generate fill (Esc cancels)"},
         {"Arrow Keys", "Move selection"},
         {"Backspace", "Clear cell"},
         {"Letters", "Fill cell"},
@@ -533,3 +566,117 @@ void GUI::drawHelpPanel() {
     window.draw(footer);
 }
 
+
+void GUI::startGeneration() {
+    auto dict = dictLoader.current();
+    if (!dict && !dictFailed) {
+        std::cerr << "Dictionary still loading..." << std::endl;
+        return;
+    }
+    grid.clearSlotAssignments();
+    grid.buildSlots();
+    history.clear();
+    if (dict) {
+        // the fill keeps this index alive even if a reload publishes a new one meanwhile
+        asyncGen.start(grid, dict->index, Generator::Strategy::MostConstrained, 0, generationTimeLimit);
+        return;
+    }
+    // no dictionary file: fall back to the small built-in pool
+    std::vector<std::string> pool = {"HELLO","WORLD","CROSS","WORDS","PUZZLE","GRID","STACK","QUEUE","TREE","GRAPH","ARRAY","VECTOR"};
+    asyncGen.start(grid, pool, Generator::Strategy::MostConstrained, 0, generationTimeLimit);
+}
+
+void GUI::updateDictionary() {
+    DictionaryLoader::State state = dictLoader.state();
+    if (state == DictionaryLoader::State::Ready) {
+        auto dict = dictLoader.current();
+        if (dict && dict->version != dictVersion) {
+            // nothing on this thread holds an older snapshot between events, and a running
+            // fill owns its own reference to the index
+            dictLoader.releaseRetired();
+            dictVersion = dict->version;
+            dictFailed = false;
+            std::cerr << (dictVersion > 1 ? "Reloaded " : "Loaded ") << dict->words << " words from "
+                      << dict->source << " in " << dictLoader.elapsedSeconds() << "s" << std::endl;
+            if (!dict->staleImage.empty())
+                std::cerr << "Note: " << dict->staleImage << " is older than the word list and was skipped; "
+                             "recompile it with crossword_batch --compile-dict." << std::endl;
+        }
+    } else if (state == DictionaryLoader::State::Failed && !dictFailed) {
+        dictFailed = true;
+        if (dictLoader.current())
+            std::cerr << "Warning: dictionary reload failed; keeping the previous word list." << std::endl;
+        else
+            std::cerr << "Warning: no dictionary found (assets/dictionary.bin or assets/dictionary.txt); "
+                         "hints are disabled and generation uses a small built-in word list." << std::endl;
+    }
+
+    // watch the files: a changed word list is rebuilt in the background and swapped in
+    bool idle = state == DictionaryLoader::State::Ready || state == DictionaryLoader::State::Failed;
+    if (idle && dictWatchClock.getElapsedTime().asSeconds() >= 2.f) {
+        dictWatchClock.restart();
+        if (dictLoader.changedOnDisk() && dictLoader.reload()) {
+            dictFailed = false;
+            std::cerr << "Dictionary changed on disk, reloading..." << std::endl;
+        }
+    }
+}
+
+void GUI::drawDictionaryStatus() {
+    if (!fontLoaded) return;
+    std::string status;
+    switch (dictLoader.state()) {
+    case DictionaryLoader::State::Loading:
+        status = (dictVersion ? "Reloading dictionary... " : "Loading dictionary... ") +
+            std::to_string(static_cast<int>(dictLoader.elapsedSeconds())) + "s";
+        break;
+    case DictionaryLoader::State::Indexing:
+        status = "Indexing " + std::to_string(dictLoader.wordCount()) + " words...";
+        break;
+    case DictionaryLoader::State::Ready:
+        status = "Dictionary: " + std::to_string(dictLoader.current()->words) + " words";
+        if (!dictLoader.current()->staleImage.empty()) status += " (compiled image out of date, using text)";
+        break;
+    case DictionaryLoader::State::Failed:
+        status = dictVersion ? "Reload failed, keeping " + std::to_string(dictLoader.current()->words) + " words"
+                             : "No dictionary (assets/dictionary.txt)";
+        break;
+    default:
+        return;
+    }
+    sf::Text text(font, status, 12u);
+    text.setFillColor(sf::Color(110, 110, 110));
+    text.setPosition(sf::Vector2f(10.f, static_cast<float>(window.getSize().y) - 22.f));
+    window.draw(text);
+}
+
+void GUI::updateGeneration() {
+    switch (asyncGen.state()) {
+    case AsyncGenerator::State::Succeeded:
+        asyncGen.takeResult(grid);
+        std::cerr << "Generated fill" << std::endl;
+        break;
+    case AsyncGenerator::State::Failed:
+        asyncGen.takeResult(grid);
+        std::cerr << "Generator found no fill" << std::endl;
+        break;
+    case AsyncGenerator::State::Cancelled:
+        asyncGen.takeResult(grid);
+        std::cerr << "Generation cancelled" << std::endl;
+        break;
+    default:
+        break;
+    }
+}
+
+void GUI::drawGenerationStatus() {
+    if (!fontLoaded || !asyncGen.running()) return;
+    Generator::Progress p = asyncGen.progress();
+    std::string status = "Generating... " + std::to_string(p.filledSlots) + "/" + std::to_string(p.totalSlots) +
+        " slots, " + std::to_string(p.stats.nodes) + " nodes (" +
+        std::to_string(static_cast<long long>(p.nodesPerSecond)) + "/s)  Esc: cancel";
+    sf::Text text(font, status, 14u);
+    text.setFillColor(sf::Color(60, 60, 60));
+    text.setPosition(sf::Vector2f(10.f, static_cast<float>(grid.rows * cellSize + 10)));
+    window.draw(text);
+}
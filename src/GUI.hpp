@@ -6,6 +6,8 @@
 #include "History.hpp"
 #include "trie.hpp"
 #include "Generator.hpp"
+#include "AsyncGenerator.hpp"
+#include "DictionaryLoader.hpp"
 #include "PuzzleBrowser.hpp"
 
 class GUI {
@@ -55,10 +57,25 @@ private:
     void saveAuto();
     void loadAuto();
     void loadPuzzleByIndex(int index);
+    void startGeneration();
+    void updateGeneration();
+    void drawGenerationStatus();
+    void updateDictionary();
+    void drawDictionaryStatus();
 
     // Data & helpers for generator/undo/hints
     History history;
-    Trie dict;
-    Generator generator{&dict};
+    // The dictionary loads in the background and is rebuilt when its file changes (or on
+    // Ctrl+R). Hints and fills take dictLoader.current() once and use that snapshot (a fill
+    // keeps its index alive itself); replaced snapshots are released once updateDictionary
+    // sees the new one. Until the first load finishes it is null and both are disabled.
+    DictionaryLoader dictLoader;
+    unsigned dictVersion = 0;   // last snapshot reported on the console
+    bool dictFailed = false;    // first load found no dictionary
+    sf::Clock dictWatchClock;   // throttles changedOnDisk() polls
+
+    // Fills run on a background worker; the render loop only polls it
+    AsyncGenerator asyncGen;
+    static constexpr double generationTimeLimit = 20.0; // seconds
 };
 
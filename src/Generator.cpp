@@ -1,18 +1,223 @@
 #include "Generator.hpp"
 #include <algorithm>
 #include <random>
-#include <ctime>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <deque>
+
+namespace {
+// Per-worker task deque: the owner pushes and pops at the back (depth-first, cache-warm),
+// idle workers steal from the front where the largest remaining subtrees sit.
+template <typename T>
+class StealQueue {
+public:
+    void push(T&& t) {
+        std::lock_guard<std::mutex> lock(m);
+        q.push_back(std::move(t));
+    }
+    bool pop(T& out) {
+        std::lock_guard<std::mutex> lock(m);
+        if (q.empty()) return false;
+        out = std::move(q.back());
+        q.pop_back();
+        return true;
+    }
+    bool steal(T& out) {
+        std::lock_guard<std::mutex> lock(m);
+        if (q.empty()) return false;
+        out = std::move(q.front());
+        q.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex m;
+    std::deque<T> q;
+};
+}
 
 Generator::Generator(Trie* dict) : dict(dict) {}
 
 bool Generator::generate(CrosswordGrid& grid, const std::vector<std::string>& wordList) {
+    loadWords(wordList);
+    return generate(grid);
+}
+
+bool Generator::generate(CrosswordGrid& grid) {
+    prepareGrid(grid);
+    if (!words) return false;
+    if (!fixedSeed) seed = std::random_device{}();
+    return search(grid);
+}
+
+Generator::ParallelResult Generator::generateParallel(CrosswordGrid& grid, const std::vector<std::string>& wordList, int threads) {
+    ParallelResult result;
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    loadWords(wordList);
+    prepareGrid(grid);
+    unsigned baseSeed = fixedSeed ? seed : std::random_device{}();
+
+    std::atomic<bool> done{false};
+    std::atomic<int> winner{-1};
+    std::vector<CrosswordGrid> grids(threads, grid);
+    std::vector<Generator> workers(threads, Generator(dict));
+    std::vector<double> finishedAt(threads, 0.0);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; ++i) {
+        Generator& w = workers[i];
+        w.strategy = strategy;
+        w.seed = baseSeed + (unsigned)i;
+        w.words = words;
+        w.cancel = cancel;
+        w.nodeBudget = nodeBudget;
+        w.timeBudget = timeBudget;
+        w.sharedStop = &done;
+        pool.emplace_back([&, i]() {
+            if (!workers[i].search(grids[i])) return;
+            finishedAt[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            int expected = -1;
+            if (winner.compare_exchange_strong(expected, i)) done = true;
+        });
+    }
+    for (auto& t : pool) t.join();
+
+    result.winner = winner.load();
+    if (result.winner >= 0) {
+        grid = grids[result.winner];
+        result.success = true;
+        result.seconds = finishedAt[result.winner];
+        result.stats = workers[result.winner].stats;
+    } else {
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.stats.cancelled = cancel && cancel->load();
+    }
+    stats = result.stats;
+    return result;
+}
+
+Generator::CountResult Generator::countSolutions(CrosswordGrid& grid, const std::vector<std::string>& wordList, int threads,
+                                                 unsigned long long limit, int splitDepth) {
+    CountResult result;
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    loadWords(wordList);
+    prepareGrid(grid);
+    buildCrossings(grid);
+    auto start = std::chrono::steady_clock::now();
+
+    Domains rootDomains;
+    if (!initDomains(grid, rootDomains)) {
+        result.complete = true;
+        return result;
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<unsigned long long> found{0};
+    std::atomic<long long> pending{1};
+    std::vector<StealQueue<SearchTask>> queues(threads);
+    std::vector<Generator> workers(threads, Generator(dict));
+    std::vector<unsigned long long> tasksRun(threads, 0), steals(threads, 0);
+    queues[0].push(SearchTask());
+
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; ++i) {
+        Generator& w = workers[i];
+        w.strategy = Strategy::MostConstrained;
+        w.words = words;
+        w.crossings = crossings;
+        w.cancel = cancel;
+        w.sharedStop = &stop;
+        w.counting = true;
+        w.solutionLimit = limit;
+        w.sharedSolutions = &found;
+        pool.emplace_back([&, i]() {
+            SearchTask task;
+            while (true) {
+                bool got = queues[i].pop(task);
+                for (int k = 1; k < threads && !got; ++k) {
+                    got = queues[(i + k) % threads].steal(task);
+                    if (got) ++steals[i];
+                }
+                if (!got) {
+                    if (pending.load() == 0) break;
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (!workers[i].stopRequested()) {
+                    workers[i].runTask(grid, rootDomains, task, splitDepth, [&](SearchTask&& child) {
+                        ++pending;
+                        queues[i].push(std::move(child));
+                    });
+                }
+                ++tasksRun[i];
+                --pending;
+            }
+        });
+    }
+    for (auto& t : pool) t.join();
+
+    bool cancelled = false;
+    for (int i = 0; i < threads; ++i) {
+        result.stats.nodes += workers[i].stats.nodes;
+        result.stats.backtracks += workers[i].stats.backtracks;
+        result.stats.solutions += workers[i].stats.solutions;
+        result.stats.skipped += workers[i].stats.skipped;
+        result.stats.nogoodHits += workers[i].stats.nogoodHits;
+        result.tasks += tasksRun[i];
+        result.steals += steals[i];
+        cancelled = cancelled || workers[i].stats.cancelled;
+    }
+    result.solutions = result.stats.solutions;
+    if (limit > 0 && result.solutions > limit) result.solutions = limit;
+    result.stats.cancelled = cancel && cancel->load();
+    result.complete = !cancelled;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats = result.stats;
+    return result;
+}
+
+template <typename Spawn>
+void Generator::runTask(const CrosswordGrid& root, const Domains& rootDomains, const SearchTask& task, int splitDepth, Spawn&& spawn) {
+    // rebuild this subtree's state privately from the root by replaying its trail
+    CrosswordGrid grid = root;
+    Domains d = rootDomains;
+    const auto& slots = grid.getSlots();
+    for (const auto& step : task.trail) {
+        const std::string& w = words->word(slots[step.first].length, step.second);
+        if (!grid.placeWordInSlot(step.first, w)) return;
+        d.assigned[step.first] = 1;
+        if (!propagate(grid, step.first, w, d, false)) return;
+    }
+
+    size_t remaining = slots.size() - task.trail.size();
+    if ((int)task.trail.size() >= splitDepth || remaining == 0) {
+        initConflictState(grid);
+        reserveSearch(grid);
+        backtrackMRV(grid, d, remaining);
+        return;
+    }
+
+    // still near the root: hand every child subtree out as its own task
+    int slotIdx = pickSlot(d);
+    WordIndex::forEachSet(d.bits[slotIdx].data(), d.bits[slotIdx].size(), [&](uint32_t id) {
+        ++stats.nodes;
+        SearchTask child;
+        child.trail.reserve(task.trail.size() + 1);
+        child.trail = task.trail;
+        child.trail.emplace_back(slotIdx, id);
+        spawn(std::move(child));
+    });
+}
+
+void Generator::prepareGrid(CrosswordGrid& grid) {
+    stats = Stats();
     grid.recomputeClueNumbers();
     grid.buildSlots();
-    std::vector<int> slotOrder(grid.getSlots().size());
-    for (size_t i = 0; i < slotOrder.size(); ++i) slotOrder[i] = (int)i;
-    // Sort by descending length to reduce branching
-    std::sort(slotOrder.begin(), slotOrder.end(), [&](int a, int b){ return grid.getSlots()[a].length > grid.getSlots()[b].length; });
+}
 
+void Generator::loadWords(const std::vector<std::string>& wordList) {
     std::vector<std::string> pool = wordList;
     // Uppercase pool
     for (auto &w : pool) {
@@ -20,58 +225,387 @@ bool Generator::generate(CrosswordGrid& grid, const std::vector<std::string>& wo
         for (char ch : w) if (std::isalpha(static_cast<unsigned char>(ch))) tmp.push_back(std::toupper(static_cast<unsigned char>(ch)));
         w = tmp;
     }
+    index.build(pool);
+    words = &index;
+}
+
+bool Generator::search(CrosswordGrid& grid) {
+    stats = Stats();
+    rng.seed(seed);
+    searchStart = std::chrono::steady_clock::now();
+    nextCheck = 0;
+    progress = Progress();
+    progress.rows = grid.rows;
+    progress.cols = grid.cols;
+    progress.totalSlots = (int)grid.getSlots().size();
+
+    bool ok = false;
+    if (strategy == Strategy::MostConstrained) {
+        buildCrossings(grid);
+        Domains d;
+        if (!initDomains(grid, d)) return false;
+        nogoods.clear();
+        initConflictState(grid);
+        reserveSearch(grid);
+        ok = backtrackMRV(grid, d, grid.getSlots().size());
+    } else {
+        std::vector<int> slotOrder(grid.getSlots().size());
+        for (size_t i = 0; i < slotOrder.size(); ++i) slotOrder[i] = (int)i;
+        // Sort by descending length to reduce branching
+        std::sort(slotOrder.begin(), slotOrder.end(), [&](int a, int b){ return grid.getSlots()[a].length > grid.getSlots()[b].length; });
+
+        // try backtracking
+        reserveSearch(grid);
+        ok = backtrackPlace(grid, slotOrder, 0);
+    }
+    grid.trail.clear();
+    candStack.clear();
+    if (ok) {
+        grid.syncSlotWords();
+        noteDepth(grid, progress.totalSlots);
+    }
+    if (progressCallback) reportProgress();
+    return ok;
+}
+
+void Generator::reserveSearch(CrosswordGrid& grid) {
+    // a cell changes at most once along a path, a slot's domain is saved at most once per
+    // crossing, and every slot on the path holds its candidates on candStack at most once,
+    // so these bounds hold for the whole search
+    const auto& slots = grid.getSlots();
+    grid.trail.clear();
+    grid.trail.reserve((size_t)grid.rows * grid.cols);
+    size_t maxBlocks = 0, candidates = 0, crossingCount = 0, savedBlocks = 0;
+    int maxLen = 0;
+    for (size_t s = 0; s < slots.size(); ++s) {
+        maxBlocks = std::max(maxBlocks, words->blocks(slots[s].length));
+        candidates += words->count(slots[s].length);
+        maxLen = std::max(maxLen, slots[s].length);
+        if (s < crossings.size()) {
+            crossingCount += crossings[s].size();
+            for (const auto& x : crossings[s]) savedBlocks += words->blocks(slots[x.other].length);
+        }
+    }
+    scratchBits.reserve(maxBlocks);
+    candStack.clear();
+    candStack.reserve(candidates);
+    patternBuf.reserve(maxLen);
+    savedDomains.clear();
+    savedDomains.reserve(crossingCount);
+    domainTrail.clear();
+    domainTrail.reserve(savedBlocks);
+}
+
+bool Generator::stopRequested() {
+    if ((cancel && cancel->load(std::memory_order_relaxed)) ||
+        (sharedStop && sharedStop->load(std::memory_order_relaxed))) {
+        stats.cancelled = true;
+        return true;
+    }
+    // once the budget is spent every level has to unwind, so the answer must stick
+    if (stats.outOfBudget) return true;
+    if (nodeBudget > 0 && stats.nodes >= nodeBudget) {
+        stats.outOfBudget = true;
+        return true;
+    }
+    // look at the clock only every so many nodes
+    if (stats.nodes >= nextCheck && (timeBudget > 0 || progressCallback)) {
+        nextCheck = stats.nodes + (progressCallback ? progressEvery : 1024);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - searchStart).count();
+        if (timeBudget > 0 && elapsed >= timeBudget) {
+            stats.outOfBudget = true;
+            return true;
+        }
+        if (progressCallback) reportProgress();
+    }
+    return false;
+}
+
+void Generator::noteDepth(const CrosswordGrid& grid, int depth) {
+    // keep a copy of the deepest partial fill for progress display
+    if (!progressCallback || depth <= progress.filledSlots) return;
+    progress.filledSlots = depth;
+    progress.bestLetters.assign(grid.letters.begin(), grid.letters.end());
+}
+
+void Generator::reportProgress() {
+    progress.stats = stats;
+    progress.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - searchStart).count();
+    progress.nodesPerSecond = progress.seconds > 0 ? stats.nodes / progress.seconds : 0.0;
+    progressCallback(progress);
+}
 
-    // try backtracking
-    return backtrackPlace(grid, slotOrder, 0, pool);
+void Generator::slotPattern(const CrosswordGrid& grid, int slotIdx, std::string& out) const {
+    CrosswordGrid::SlotView view = grid.slotLetters(slotIdx);
+    out.resize(view.length);
+    for (int k = 0; k < view.length; ++k) out[k] = view[k];
 }
 
-bool Generator::backtrackPlace(CrosswordGrid& grid, std::vector<int>& slotOrder, size_t idx, const std::vector<std::string>& pool) {
+bool Generator::backtrackPlace(CrosswordGrid& grid, std::vector<int>& slotOrder, size_t idx) {
     if (idx >= slotOrder.size()) return true;
+    noteDepth(grid, (int)idx);
     int slotIdx = slotOrder[idx];
     const auto& slots = grid.getSlots();
     auto len = slots[slotIdx].length;
 
-    // collect candidate words of matching length that also fit existing letters
-    std::vector<std::string> candidates;
-    for (const auto& w : pool) {
-        if ((int)w.size() != len) continue;
-        bool ok = true;
-        for (int k = 0; k < (int)len; ++k) {
-            int r = slots[slotIdx].r + (slots[slotIdx].across ? 0 : k);
-            int c = slots[slotIdx].c + (slots[slotIdx].across ? k : 0);
-            char ch = grid.getLetter(r, c);
-            if (ch != ' ' && ch != w[k]) { ok = false; break; }
-        }
-        if (ok) candidates.push_back(w);
-    }
+    // candidate ids: AND of the postings of the letters already in the slot
+    size_t base = candStack.size();
+    slotPattern(grid, slotIdx, patternBuf);
+    scratchBits.resize(words->blocks(len));
+    if (words->match(patternBuf, scratchBits.data()) > 0)
+        WordIndex::forEachSet(scratchBits.data(), scratchBits.size(), [&](uint32_t id){ candStack.push_back(id); });
 
     // shuffle candidates for variability
-    std::mt19937 gen(static_cast<unsigned>(std::time(nullptr)) + (int)idx);
-    std::shuffle(candidates.begin(), candidates.end(), gen);
+    std::shuffle(candStack.begin() + base, candStack.end(), rng);
 
     // try each
-    for (auto &cand : candidates) {
-        // snapshot letters to restore on backtrack
-        std::vector<char> snap;
-        snap.reserve(slots[slotIdx].length);
-        for (int k = 0; k < slots[slotIdx].length; ++k) {
-            int r = slots[slotIdx].r + (slots[slotIdx].across ? 0 : k);
-            int c = slots[slotIdx].c + (slots[slotIdx].across ? k : 0);
-            snap.push_back(grid.getLetter(r,c));
+    for (size_t i = base; i < candStack.size(); ++i) {
+        if (stopRequested()) break;
+        ++stats.nodes;
+        size_t mark = grid.trailMark();
+        if (!grid.placeWordTrailed(slotIdx, words->word(len, candStack[i]))) continue;
+        if (backtrackPlace(grid, slotOrder, idx + 1)) return true;
+
+        ++stats.backtracks;
+        grid.rollback(mark);
+    }
+
+    candStack.resize(base);
+    return false;
+}
+
+void Generator::buildCrossings(const CrosswordGrid& grid) {
+    const auto& slots = grid.getSlots();
+    crossings.assign(slots.size(), {});
+    for (size_t s = 0; s < slots.size(); ++s) {
+        CrosswordGrid::SlotView view = grid.slotLetters(slots[s]);
+        for (int k = 0; k < view.length; ++k) {
+            const CrosswordGrid::CellSlots& at = grid.cellSlots[view.cell(k)];
+            int other = slots[s].across ? at.down : at.across;
+            if (other >= 0) crossings[s].push_back({k, other, slots[s].across ? at.downPos : at.acrossPos});
+        }
+    }
+}
+
+bool Generator::initDomains(const CrosswordGrid& grid, Domains& d) const {
+    const auto& slots = grid.getSlots();
+    // initial domains: words of matching length that fit letters already in the grid
+    d.bits.assign(slots.size(), {});
+    d.size.assign(slots.size(), 0);
+    d.assigned.assign(slots.size(), 0);
+    std::string pattern;
+    for (size_t s = 0; s < slots.size(); ++s) {
+        d.bits[s].assign(words->blocks(slots[s].length), 0);
+        slotPattern(grid, (int)s, pattern);
+        d.size[s] = words->match(pattern, d.bits[s].data());
+        if (d.size[s] == 0) return false;
+    }
+    return true;
+}
+
+int Generator::pickSlot(const Domains& d) const {
+    // the unassigned slot with the fewest live candidates; prefer more crossings on ties
+    int slotIdx = -1;
+    for (size_t s = 0; s < d.size.size(); ++s) {
+        if (d.assigned[s]) continue;
+        if (slotIdx < 0 || d.size[s] < d.size[slotIdx] ||
+            (d.size[s] == d.size[slotIdx] && crossings[s].size() > crossings[slotIdx].size()))
+            slotIdx = (int)s;
+    }
+    return slotIdx;
+}
+
+bool Generator::propagate(const CrosswordGrid& grid, int slotIdx, const std::string& word, Domains& d, bool save, int* wiped) {
+    // forward check: AND every unassigned crossing domain with the posting of the shared letter
+    const auto& slots = grid.getSlots();
+    bool track = save && useBackjumping();
+    for (const auto& x : crossings[slotIdx]) {
+        if (d.assigned[x.other]) continue;
+        auto& bits = d.bits[x.other];
+        size_t before = d.size[x.other];
+        if (save) {
+            savedDomains.push_back({x.other, before, domainTrail.size(), false});
+            domainTrail.insert(domainTrail.end(), bits.begin(), bits.end());
+        }
+        d.size[x.other] = WordIndex::andCount(bits.data(),
+            words->posting(slots[x.other].length, x.otherPos, word[x.pos]), bits.size());
+        if (track && d.size[x.other] < before) {
+            prunedBy[x.other].push_back(slotIdx);
+            savedDomains.back().narrowed = true;
+        }
+        if (d.size[x.other] == 0) {
+            if (wiped) *wiped = x.other;
+            return false;
+        }
+    }
+    return true;
+}
+
+void Generator::restoreDomains(Domains& d, size_t mark) {
+    while (savedDomains.size() > mark) {
+        const SavedDomain& sd = savedDomains.back();
+        if (sd.narrowed) prunedBy[sd.slot].pop_back();
+        auto& bits = d.bits[sd.slot];
+        std::copy(domainTrail.begin() + sd.offset, domainTrail.begin() + sd.offset + bits.size(), bits.begin());
+        d.size[sd.slot] = sd.size;
+        domainTrail.resize(sd.offset);
+        savedDomains.pop_back();
+    }
+}
+
+void Generator::hashPlacement(const CrosswordGrid& grid, size_t trailMark) {
+    // cells that were blank before the placement now hold a letter (placing and undoing
+    // are both an XOR, so this is called before rollback too)
+    for (size_t i = trailMark; i < grid.trail.size(); ++i) {
+        const auto& e = grid.trail[i];
+        if (e.letter == ' ') hashCell(e.cell, grid.letters[e.cell]);
+    }
+}
+
+void Generator::initConflictState(const CrosswordGrid& grid) {
+    size_t n = grid.getSlots().size();
+    // allocated on the first call only: every task of a countSolutions worker has the same
+    // slots, so later calls just clear what the previous search left behind
+    depthOf.assign(n, -1);
+    prunedBy.resize(n);
+    for (size_t s = 0; s < n; ++s) {
+        prunedBy[s].clear();
+        if (s < crossings.size()) prunedBy[s].reserve(crossings[s].size());
+    }
+    if (conflicts.size() != n) conflicts.assign(n, std::vector<char>(n, 0));
+    else for (auto& row : conflicts) std::fill(row.begin(), row.end(), 0);
+    assignOrder.clear();
+    assignOrder.reserve(n);
+    jumpTarget = -1;
+
+    size_t cells = (size_t)grid.rows * grid.cols;
+    if (zobrist.size() != cells * 26 * 2) {
+        std::mt19937_64 keys(0x9E3779B97F4A7C15ULL);
+        zobrist.resize(cells * 26 * 2);
+        for (auto& z : zobrist) z = keys();
+    }
+    if (nogoodCapacity > 0 && nogoods.empty()) {
+        size_t cap = 1;
+        while (cap < nogoodCapacity) cap <<= 1;
+        nogoods.assign(cap * 2, 0);
+    }
+    // nonzero start so no real state hashes to an empty table entry
+    stateHash[0] = 0x243F6A8885A308D3ULL;
+    stateHash[1] = 0x13198A2E03707344ULL;
+    for (size_t cell = 0; cell < grid.letters.size(); ++cell)
+        if (!(grid.flags[cell] & CrosswordGrid::Blocked)) hashCell((int)cell, grid.letters[cell]);
+}
+
+void Generator::hashCell(int cell, char letter) {
+    if (letter < 'A' || letter > 'Z') return;
+    size_t i = ((size_t)cell * 26 + (letter - 'A')) * 2;
+    stateHash[0] ^= zobrist[i];
+    stateHash[1] ^= zobrist[i + 1];
+}
+
+bool Generator::nogoodContains() const {
+    if (nogoods.empty()) return false;
+    size_t i = (stateHash[0] & (nogoods.size() / 2 - 1)) * 2;
+    return nogoods[i] == stateHash[0] && nogoods[i + 1] == stateHash[1];
+}
+
+void Generator::nogoodInsert() {
+    if (nogoods.empty()) return;
+    size_t i = (stateHash[0] & (nogoods.size() / 2 - 1)) * 2;
+    nogoods[i] = stateHash[0];
+    nogoods[i + 1] = stateHash[1];
+}
+
+bool Generator::backtrackMRV(CrosswordGrid& grid, Domains& d, size_t remaining) {
+    if (remaining == 0) {
+        if (!counting) return true;
+        ++stats.solutions;
+        if (solutionLimit > 0 && sharedSolutions->fetch_add(1) + 1 >= solutionLimit) *sharedStop = true;
+        return false;
+    }
+    int parent = assignOrder.empty() ? -1 : assignOrder.back();
+    // The letters alone determine every remaining domain, so a letter state that failed
+    // before fails again; its conflicts are unknown, so unwind chronologically.
+    if (nogoodContains()) {
+        ++stats.nogoodHits;
+        ++stats.skipped;
+        if (parent >= 0 && useBackjumping())
+            for (int s : assignOrder) if (s != parent) conflicts[parent][s] = 1;
+        jumpTarget = parent;
+        return false;
+    }
+
+    const auto& slots = grid.getSlots();
+    noteDepth(grid, (int)assignOrder.size());
+    int slotIdx = pickSlot(d);
+    bool cbj = useBackjumping();
+
+    int len = slots[slotIdx].length;
+    size_t base = candStack.size();
+    WordIndex::forEachSet(d.bits[slotIdx].data(), d.bits[slotIdx].size(), [&](uint32_t id){ candStack.push_back(id); });
+    if (!counting) std::shuffle(candStack.begin() + base, candStack.end(), rng);
+    size_t end = candStack.size();
+    d.assigned[slotIdx] = 1;
+    if (cbj) {
+        depthOf[slotIdx] = (int)assignOrder.size();
+        std::fill(conflicts[slotIdx].begin(), conflicts[slotIdx].end(), 0);
+    }
+    assignOrder.push_back(slotIdx);
+    unsigned long long solutionsBefore = stats.solutions;
+    bool jumped = false, stopped = false;
+
+    for (size_t ci = base; ci < end; ++ci) {
+        if (stopRequested()) { stopped = true; break; }
+        const std::string& cand = words->word(len, candStack[ci]);
+
+        ++stats.nodes;
+        size_t mark = grid.trailMark();
+        if (!grid.placeWordTrailed(slotIdx, cand)) continue;
+        hashPlacement(grid, mark);
+
+        size_t savedMark = savedDomains.size();
+        int wiped = -1;
+        if (!propagate(grid, slotIdx, cand, d, true, &wiped)) {
+            // the wiped slot's other pruners share the blame for this value
+            if (cbj) for (int p : prunedBy[wiped]) if (p != slotIdx) conflicts[slotIdx][p] = 1;
+        } else if (backtrackMRV(grid, d, remaining - 1)) {
+            return true;
+        } else if (cbj && jumpTarget != slotIdx && !stats.cancelled && !stats.outOfBudget) {
+            // the failure below does not involve this slot: skip its other candidates
+            jumped = true;
+            ++stats.backjumps;
+            stats.skipped += end - ci - 1;
         }
 
-        if (!grid.placeWordInSlot(slotIdx, cand)) continue;
-        if (backtrackPlace(grid, slotOrder, idx + 1, pool)) return true;
+        ++stats.backtracks;
+        restoreDomains(d, savedMark);
+        hashPlacement(grid, mark);
+        grid.rollback(mark);
+        if (jumped) break;
+    }
+    candStack.resize(base);
+    stopped = stopped || stats.cancelled || stats.outOfBudget;
 
-        // undo placement
-        for (int k = 0; k < slots[slotIdx].length; ++k) {
-            int r = slots[slotIdx].r + (slots[slotIdx].across ? 0 : k);
-            int c = slots[slotIdx].c + (slots[slotIdx].across ? k : 0);
-            grid.grid[r][c].letter = snap[k];
-            grid.grid[r][c].isEditable = (snap[k] == ' ');
+    if (!jumped) {
+        if (cbj) {
+            // every value failed: jump to the deepest slot in conflicts + prunedBy and hand it the rest
+            std::vector<char>& conf = conflicts[slotIdx];
+            for (int p : prunedBy[slotIdx]) conf[p] = 1;
+            int target = -1;
+            for (size_t s = 0; s < conf.size(); ++s)
+                if (conf[s] && (target < 0 || depthOf[s] > depthOf[target])) target = (int)s;
+            if (target >= 0)
+                for (size_t s = 0; s < conf.size(); ++s)
+                    if (conf[s] && (int)s != target) conflicts[target][s] = 1;
+            jumpTarget = target;
+        } else {
+            jumpTarget = parent;
         }
-        grid.slots[slotIdx].word.clear();
     }
+    if (!stopped && stats.solutions == solutionsBefore) nogoodInsert();
 
+    assignOrder.pop_back();
+    if (cbj) depthOf[slotIdx] = -1;
+    d.assigned[slotIdx] = 0;
     return false;
 }
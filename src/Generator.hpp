@@ -1,16 +1,201 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <random>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include "CrosswordGrid.hpp"
 #include "trie.hpp"
+#include "WordIndex.hpp"
 
 class Generator {
 public:
+    // How the next slot to fill is chosen
+    enum class Strategy {
+        StaticOrder,     // slots sorted once by descending length
+        MostConstrained  // smallest live domain first, with forward checking on crossing slots
+    };
+
+    // Search counters for the last generate() call
+    struct Stats {
+        unsigned long long nodes = 0;      // candidate placements tried
+        unsigned long long backtracks = 0; // placements undone or rejected by forward checking
+        unsigned long long solutions = 0;  // complete fills found (countSolutions only)
+        unsigned long long backjumps = 0;  // levels unwound past because they were not in the conflict
+        unsigned long long skipped = 0;    // candidates never tried thanks to backjumps and nogood hits
+        unsigned long long nogoodHits = 0; // nodes cut because their letter state was already proven dead
+        bool cancelled = false;            // search stopped by a cancel flag
+        bool outOfBudget = false;          // search stopped by the node or time budget
+    };
+
+    // Snapshot handed to the progress callback
+    struct Progress {
+        Stats stats;
+        double seconds = 0.0;
+        double nodesPerSecond = 0.0;
+        int rows = 0, cols = 0;
+        int filledSlots = 0;           // slots placed in the deepest partial fill so far
+        int totalSlots = 0;
+        std::vector<char> bestLetters; // that fill, row-major, ' ' for empty cells
+    };
+    using ProgressCallback = std::function<void(const Progress&)>;
+
+    // Outcome of generateParallel()
+    struct ParallelResult {
+        bool success = false;
+        int winner = -1;      // index of the worker whose fill was kept
+        double seconds = 0.0; // wall time until the winner finished
+        Stats stats;          // winner's counters
+    };
+
+    // Outcome of countSolutions()
+    struct CountResult {
+        unsigned long long solutions = 0;
+        bool complete = false;           // whole tree searched (no limit hit, not cancelled)
+        double seconds = 0.0;
+        unsigned long long tasks = 0;    // subtree tasks executed
+        unsigned long long steals = 0;   // tasks taken from another worker's queue
+        Stats stats;                     // summed over all workers
+    };
+
     Generator(Trie* dict=nullptr);
     // attempt to fill slots in grid using words from provided list; returns true if success
     bool generate(CrosswordGrid& grid, const std::vector<std::string>& wordList);
+    // Fill with the words given to loadWords/useWords
+    bool generate(CrosswordGrid& grid);
+    // Normalize and index a word list once for repeated generate(grid) calls
+    void loadWords(const std::vector<std::string>& wordList);
+    // Search an index owned elsewhere (e.g. shared by batch workers); it must outlive the generator
+    void useWords(const WordIndex* shared) { words = shared; }
+    const WordIndex* getWords() const { return words; }
+
+    // Portfolio mode: run `threads` independent randomized searches (seed, seed+1, ...) on
+    // private copies of grid; the first fill found is copied back and the others are
+    // cancelled. threads <= 0 uses the hardware concurrency.
+    ParallelResult generateParallel(CrosswordGrid& grid, const std::vector<std::string>& wordList, int threads = 0);
+
+    // Exhaustive MostConstrained search that counts complete fills (stopping at limit when
+    // limit > 0) without changing the grid's letters. Subtrees rooted at the first
+    // splitDepth levels become tasks on per-worker deques that idle workers steal from.
+    // solutions == 0 with complete == true proves the template unfillable with this list.
+    CountResult countSolutions(CrosswordGrid& grid, const std::vector<std::string>& wordList, int threads = 0,
+                               unsigned long long limit = 0, int splitDepth = 2);
+
+    // Fix the shuffle seed; otherwise every call draws a fresh one
+    void setSeed(unsigned s) { seed = s; fixedSeed = true; }
+    // Searches poll this flag and give up once it is set
+    void setCancelFlag(const std::atomic<bool>* flag) { cancel = flag; }
+    // Give up after maxNodes placements or maxSeconds of searching (0 = unlimited)
+    void setBudget(unsigned long long maxNodes, double maxSeconds) { nodeBudget = maxNodes; timeBudget = maxSeconds; }
+    // Called from the searching thread every `everyNodes` placements and once at the end
+    void setProgressCallback(ProgressCallback cb, unsigned long long everyNodes = 4096) {
+        progressCallback = std::move(cb);
+        progressEvery = everyNodes > 0 ? everyNodes : 1;
+    }
+
+    // MostConstrained only: conflict-directed backjumping (ignored while counting) and the
+    // size of the direct-mapped cache of dead letter states (0 disables it)
+    void setBackjumping(bool on) { backjumping = on; }
+    void setNogoodCapacity(size_t entries) { nogoodCapacity = entries; }
+
+    void setStrategy(Strategy s) { strategy = s; }
+    Strategy getStrategy() const { return strategy; }
+    const Stats& getStats() const { return stats; }
 
 private:
+    struct Crossing {
+        int pos;      // index of the shared cell in this slot
+        int other;    // crossing slot index
+        int otherPos; // index of the shared cell in the crossing slot
+    };
+    // Live candidate sets of the MostConstrained search, as WordIndex bitsets per slot
+    struct Domains {
+        std::vector<std::vector<WordIndex::Block>> bits;
+        std::vector<size_t> size;
+        std::vector<char> assigned;
+    };
+    struct SavedDomain {
+        int slot;
+        size_t size;
+        size_t offset; // previous bits start at domainTrail[offset]
+        bool narrowed; // domain shrank, so the placing slot went onto prunedBy[slot]
+    };
+    // A subtree of countSolutions: the (slot, word id) placements leading to it from the root
+    struct SearchTask {
+        std::vector<std::pair<int, uint32_t>> trail;
+    };
+
     Trie* dict = nullptr;
-    bool backtrackPlace(CrosswordGrid& grid, std::vector<int>& slotOrder, size_t idx, const std::vector<std::string>& pool);
+    Strategy strategy = Strategy::StaticOrder;
+    Stats stats;
+    std::mt19937 rng;
+    unsigned seed = 0;
+    bool fixedSeed = false;
+    const std::atomic<bool>* cancel = nullptr;
+    std::atomic<bool>* sharedStop = nullptr; // shared by the workers of generateParallel/countSolutions
+    unsigned long long nodeBudget = 0;
+    double timeBudget = 0.0;
+    std::chrono::steady_clock::time_point searchStart;
+    unsigned long long nextCheck = 0; // stats.nodes at which the clock and progress are next looked at
+    ProgressCallback progressCallback;
+    unsigned long long progressEvery = 4096;
+    Progress progress;
+    // countSolutions: keep searching past complete fills and publish them here
+    bool counting = false;
+    unsigned long long solutionLimit = 0;
+    std::atomic<unsigned long long>* sharedSolutions = nullptr;
+    std::vector<std::vector<Crossing>> crossings; // per slot
+
+    // Backjumping state, per slot: assignment depth (-1 if unassigned), the slots whose
+    // placement narrowed its domain (in order) and the conflict set gathered from failures
+    bool backjumping = true;
+    std::vector<int> depthOf;
+    std::vector<std::vector<int>> prunedBy;
+    std::vector<std::vector<char>> conflicts;
+    std::vector<int> assignOrder;
+    int jumpTarget = -1; // slot a failed subtree unwinds to (-1: no assignment can fix it)
+
+    // Nogood cache keyed on a 128-bit Zobrist hash of the grid letters
+    size_t nogoodCapacity = 1 << 16;
+    std::vector<uint64_t> zobrist;  // 2 keys per (cell, letter)
+    std::vector<uint64_t> nogoods;  // 2 words per entry
+    uint64_t stateHash[2] = {0, 0};
+
+    // Search stacks reserved up front and reused, so visiting a node allocates nothing
+    std::vector<uint32_t> candStack;           // candidate ids of every open node
+    std::vector<WordIndex::Block> scratchBits; // StaticOrder candidate bitset
+    std::string patternBuf;
+    std::vector<SavedDomain> savedDomains;     // domains overwritten by forward checking
+    std::vector<WordIndex::Block> domainTrail; // their previous bits
+
+    WordIndex index;                  // word pool of the current generate() call
+    const WordIndex* words = nullptr; // index searched; portfolio workers share the caller's
+
+    void prepareGrid(CrosswordGrid& grid);
+    bool search(CrosswordGrid& grid);
+    bool stopRequested();
+    void noteDepth(const CrosswordGrid& grid, int depth);
+    void reportProgress();
+    bool backtrackPlace(CrosswordGrid& grid, std::vector<int>& slotOrder, size_t idx);
+
+    void buildCrossings(const CrosswordGrid& grid);
+    bool initDomains(const CrosswordGrid& grid, Domains& d) const;
+    int pickSlot(const Domains& d) const;
+    // Narrow the unassigned crossings of slotIdx to its new word; false on a wipe-out.
+    // Previous domains are pushed onto savedDomains when save is set; restoreDomains
+    // pops them back to a mark. Sets *wiped to the slot whose domain emptied.
+    bool propagate(const CrosswordGrid& grid, int slotIdx, const std::string& word, Domains& d, bool save, int* wiped = nullptr);
+    void restoreDomains(Domains& d, size_t mark);
+    void reserveSearch(CrosswordGrid& grid);
+    bool backtrackMRV(CrosswordGrid& grid, Domains& d, size_t remaining);
+    bool useBackjumping() const { return backjumping && !counting; }
+    void initConflictState(const CrosswordGrid& grid);
+    void hashCell(int cell, char letter); // cell: row-major index
+    bool nogoodContains() const;
+    void nogoodInsert();
+    template <typename Spawn>
+    void runTask(const CrosswordGrid& root, const Domains& rootDomains, const SearchTask& task, int splitDepth, Spawn&& spawn);
+    void slotPattern(const CrosswordGrid& grid, int slotIdx, std::string& out) const;
+    void hashPlacement(const CrosswordGrid& grid, size_t trailMark);
 };
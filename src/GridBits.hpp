@@ -0,0 +1,225 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// A set of grid cells as a bitboard: bit r * cols + c, 64 cells per word, row-major like
+// CrosswordGrid. Neighbour, run and region questions about a whole grid become a few shifts
+// and ANDs per word instead of loops over cells. GridBits<Rows, Cols> fixes the size at
+// compile time, so the words live in a std::array and every loop has a constant trip count;
+// GridBits<> (Rows == 0) is the same code with the size and words chosen at runtime. Use
+// withGridBits to pick the fixed-size type for the standard sizes automatically.
+template <int Rows = 0, int Cols = 0>
+class GridBits {
+public:
+    static constexpr bool Fixed = Rows > 0 && Cols > 0;
+    using Word = std::uint64_t;
+
+    template <bool F = Fixed, typename std::enable_if<F, int>::type = 0>
+    GridBits() {}
+    template <bool F = Fixed, typename std::enable_if<!F, int>::type = 0>
+    GridBits(int rows, int cols) : R(rows), C(cols), w((size_t)(rows * cols + 63) / 64, 0) {}
+
+    int rows() const { return R; }
+    int cols() const { return C; }
+    int cells() const { return R * C; }
+    // An empty set of the same size
+    GridBits empty() const {
+        GridBits out(*this);
+        out.clear();
+        return out;
+    }
+
+    bool test(int cell) const { return (w[cell >> 6] >> (cell & 63)) & 1u; }
+    void set(int cell) { w[cell >> 6] |= Word(1) << (cell & 63); }
+    void reset(int cell) { w[cell >> 6] &= ~(Word(1) << (cell & 63)); }
+    void assign(int cell, bool value) { if (value) set(cell); else reset(cell); }
+    void clear() { for (auto& x : w) x = 0; }
+    void fill() {
+        for (auto& x : w) x = ~Word(0);
+        trim();
+    }
+
+    bool none() const {
+        Word any = 0;
+        for (Word x : w) any |= x;
+        return any == 0;
+    }
+    int count() const {
+        int n = 0;
+        for (Word x : w) n += popcount(x);
+        return n;
+    }
+    int first() const { // lowest set cell, -1 if none
+        for (size_t i = 0; i < w.size(); ++i)
+            if (w[i]) return (int)(i * 64) + countTrailingZeros(w[i]);
+        return -1;
+    }
+    bool operator==(const GridBits& o) const {
+        for (size_t i = 0; i < w.size(); ++i)
+            if (w[i] != o.w[i]) return false;
+        return true;
+    }
+    bool operator!=(const GridBits& o) const { return !(*this == o); }
+    // f(cell) for every set cell, lowest first (row-major order)
+    template <typename F>
+    void forEach(F&& f) const {
+        for (size_t i = 0; i < w.size(); ++i)
+            for (Word x = w[i]; x; x &= x - 1) f((int)(i * 64) + countTrailingZeros(x));
+    }
+
+    GridBits& operator&=(const GridBits& o) { for (size_t i = 0; i < w.size(); ++i) w[i] &= o.w[i]; return *this; }
+    GridBits& operator|=(const GridBits& o) { for (size_t i = 0; i < w.size(); ++i) w[i] |= o.w[i]; return *this; }
+    GridBits& andNot(const GridBits& o) { for (size_t i = 0; i < w.size(); ++i) w[i] &= ~o.w[i]; return *this; }
+    GridBits operator&(const GridBits& o) const { GridBits out(*this); return out &= o; }
+    GridBits operator|(const GridBits& o) const { GridBits out(*this); return out |= o; }
+
+    // Cell i moves to i + k (k > 0: right/down) or i - |k|; cells pushed past either end of
+    // the grid are dropped. Row wrap-around is the caller's business (see rowMasks).
+    GridBits shifted(int k) const {
+        GridBits out = empty();
+        for (int i = 0; i < (int)w.size(); ++i) out.w[i] = shiftedWord(i, k);
+        out.trim();
+        return out;
+    }
+
+    // Cells whose column is at least lo and below hi
+    GridBits columns(int lo, int hi) const {
+        GridBits out = empty();
+        for (int r = 0; r < R; ++r)
+            for (int c = lo; c < hi; ++c) out.set(r * C + c);
+        return out;
+    }
+
+    // Row-edge masks for the neighbour and run tests, built once per grid size: [0] cells
+    // with a left neighbour in their row, [k] cells with at least k more cells to their right
+    // (k < max(2, longest))
+    std::vector<GridBits> rowMasks(int longest) const {
+        std::vector<GridBits> masks;
+        masks.push_back(columns(1, C));
+        for (int k = 1; k < longest || k < 2; ++k) masks.push_back(columns(0, C - k));
+        return masks;
+    }
+
+    // Every set cell can reach every other one through set cells sharing an edge (false if
+    // none are set)
+    bool connected(const std::vector<GridBits>& masks) const {
+        int start = first();
+        if (start < 0) return false;
+        GridBits reach = empty();
+        reach.set(start);
+        const int n = (int)w.size();
+        bool grew = true;
+        auto grow = [&](int i) {
+            Word x = reach.w[i];
+            Word g = (x | (reach.shiftedWord(i, 1) & masks[0].w[i]) | (reach.shiftedWord(i, -1) & masks[1].w[i]) |
+                      reach.shiftedWord(i, C) | reach.shiftedWord(i, -C)) & w[i];
+            if (g != x) { reach.w[i] = g; grew = true; }
+        };
+        // grow in place: the forward sweep reads words it already grew, so growth right and
+        // down carries across word boundaries within one sweep; the backward sweep does the
+        // same up and left
+        while (grew) {
+            grew = false;
+            for (int i = 0; i < n; ++i) grow(i);
+            for (int i = n - 1; i >= 0; --i) grow(i);
+        }
+        return reach == *this;
+    }
+
+    // No run of set cells along a row or a column is shorter than minLength; masks from
+    // rowMasks(minLength)
+    bool runsAtLeast(int minLength, const std::vector<GridBits>& masks) const {
+        if (minLength <= 1) return true;
+        for (int i = 0; i < (int)w.size(); ++i) {
+            // a run starts at a set cell with the edge or a clear cell before it; every start
+            // must be followed by minLength - 1 more set cells in the same line
+            Word startsAcross = w[i] & ~(shiftedWord(i, 1) & masks[0].w[i]);
+            Word startsDown = w[i] & ~shiftedWord(i, C);
+            Word across = startsAcross, down = startsDown;
+            for (int k = 1; k < minLength; ++k) {
+                across &= shiftedWord(i, -k) & masks[k].w[i];
+                down &= shiftedWord(i, -k * C);
+            }
+            if (across != startsAcross || down != startsDown) return false;
+        }
+        return true;
+    }
+
+    // First cells of the runs of at least 2 set cells along a row / down a column; masks
+    // from rowMasks(2) or longer
+    GridBits acrossStarts(const std::vector<GridBits>& masks) const {
+        GridBits out = empty();
+        for (int i = 0; i < (int)w.size(); ++i)
+            out.w[i] = w[i] & ~(shiftedWord(i, 1) & masks[0].w[i]) & shiftedWord(i, -1) & masks[1].w[i];
+        return out;
+    }
+    GridBits downStarts() const {
+        GridBits out = empty();
+        for (int i = 0; i < (int)w.size(); ++i) out.w[i] = w[i] & ~shiftedWord(i, C) & shiftedWord(i, -C);
+        return out;
+    }
+
+private:
+    static constexpr int FixedWords = Fixed ? (Rows * Cols + 63) / 64 : 1;
+    using Storage = typename std::conditional<Fixed, std::array<Word, FixedWords>, std::vector<Word>>::type;
+    using Dim = typename std::conditional<Fixed, std::integral_constant<int, Rows>, int>::type;
+    using DimC = typename std::conditional<Fixed, std::integral_constant<int, Cols>, int>::type;
+
+    Dim R{};
+    DimC C{};
+    Storage w{};
+
+    void trim() {
+        int extra = (int)w.size() * 64 - cells();
+        if (extra > 0) w[w.size() - 1] &= ~Word(0) >> extra;
+    }
+    // Word i of this shifted by k cells (see shifted)
+    Word shiftedWord(int i, int k) const {
+        const int n = (int)w.size();
+        int words = (k < 0 ? -k : k) >> 6, bits = (k < 0 ? -k : k) & 63;
+        if (k >= 0) {
+            int j = i - words;
+            if (j < 0) return 0;
+            Word x = w[j] << bits;
+            if (bits && j > 0) x |= w[j - 1] >> (64 - bits);
+            return x;
+        }
+        int j = i + words;
+        if (j >= n) return 0;
+        Word x = w[j] >> bits;
+        if (bits && j + 1 < n) x |= w[j + 1] << (64 - bits);
+        return x;
+    }
+    static int popcount(Word x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(x);
+#else
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+    static int countTrailingZeros(Word x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(x);
+#else
+        int n = 0;
+        while (!(x & 1)) { x >>= 1; ++n; }
+        return n;
+#endif
+    }
+};
+
+// Call f(bits) with an empty GridBits of the given size: fixed-size for the standard 5x5,
+// 15x15 and 21x21 grids, runtime-sized otherwise. f is instantiated once per type.
+template <typename F>
+decltype(auto) withGridBits(int rows, int cols, F&& f) {
+    if (rows == 15 && cols == 15) return f(GridBits<15, 15>());
+    if (rows == 21 && cols == 21) return f(GridBits<21, 21>());
+    if (rows == 5 && cols == 5) return f(GridBits<5, 5>());
+    return f(GridBits<>(rows, cols));
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file (mmap on POSIX, a file mapping view on
+// Windows). Pages are shared between every process that maps the same file.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return data != nullptr; }
+    const unsigned char* bytes() const { return static_cast<const unsigned char*>(data); }
+    size_t size() const { return length; }
+
+private:
+    const void* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
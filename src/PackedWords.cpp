@@ -0,0 +1,137 @@
+#include "PackedWords.hpp"
+#include <algorithm>
+#include <cctype>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PACKED_WORDS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+inline int popcount32(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    return (int)((((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
+}
+}
+
+const char* PackedWords::kernel() {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(PACKED_WORDS_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void PackedWords::build(const std::vector<std::string>& words, uint32_t lengthMask) {
+    clear();
+    buckets.resize(MaxLength + 1);
+    for (const auto& w : words)
+        if (!w.empty() && w.size() <= MaxLength && (lengthMask & (1u << w.size()))) ++buckets[w.size()].count;
+    for (size_t len = 1; len <= MaxLength; ++len) {
+        Bucket& b = buckets[len];
+        b.blocks = (b.count + Lanes - 1) / Lanes;
+        b.rows.reserve(b.count * len);
+        b.cols.assign(b.blocks * len * Lanes, 0);
+    }
+    for (const auto& w : words) {
+        size_t len = w.size();
+        if (len == 0 || len > MaxLength || !(lengthMask & (1u << len))) continue;
+        Bucket& b = buckets[len];
+        size_t id = b.rows.size() / len;
+        b.rows.insert(b.rows.end(), w.begin(), w.end());
+        unsigned char* col = b.cols.data() + (id / Lanes) * len * Lanes + id % Lanes;
+        for (size_t k = 0; k < len; ++k) col[k * Lanes] = (unsigned char)w[k];
+    }
+    while (!buckets.empty() && buckets.back().count == 0) buckets.pop_back();
+}
+
+size_t PackedWords::memoryBytes() const {
+    size_t bytes = buckets.capacity() * sizeof(Bucket);
+    for (const auto& b : buckets) bytes += b.rows.capacity() + b.cols.capacity();
+    return bytes;
+}
+
+bool PackedWords::prepare(const std::string& pattern, Query& q) const {
+    if (!has(pattern.size())) return false;
+    q.length = pattern.size();
+    q.known = 0;
+    for (size_t k = 0; k < pattern.size(); ++k) {
+        char p = pattern[k];
+        if (p == '_' || p == '?') continue;
+        if (!std::isalpha(static_cast<unsigned char>(p))) return false;
+        int i = std::toupper(static_cast<unsigned char>(p)) - 'A';
+        if (i < 0 || i >= 26) return false;
+        q.pos[q.known] = (unsigned char)k;
+        q.letter[q.known] = (unsigned char)('A' + i);
+        ++q.known;
+    }
+    return true;
+}
+
+size_t PackedWords::scan(const Bucket& b, const Query& q, size_t first, uint32_t* masks) const {
+    size_t n = std::min(ChunkBlocks, b.blocks - first);
+    const size_t stride = q.length * Lanes;
+    const unsigned char* base = b.cols.data() + first * stride;
+#if defined(__AVX2__)
+    __m256i want[MaxLength];
+    for (int j = 0; j < q.known; ++j) want[j] = _mm256_set1_epi8((char)q.letter[j]);
+    for (size_t i = 0; i < n; ++i, base += stride) {
+        __m256i eq = _mm256_set1_epi8(-1);
+        for (int j = 0; j < q.known; ++j) {
+            __m256i col = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + q.pos[j] * Lanes));
+            eq = _mm256_and_si256(eq, _mm256_cmpeq_epi8(col, want[j]));
+        }
+        masks[i] = (uint32_t)_mm256_movemask_epi8(eq);
+    }
+#elif defined(PACKED_WORDS_SSE2)
+    __m128i want[MaxLength];
+    for (int j = 0; j < q.known; ++j) want[j] = _mm_set1_epi8((char)q.letter[j]);
+    for (size_t i = 0; i < n; ++i, base += stride) {
+        __m128i lo = _mm_set1_epi8(-1), hi = lo;
+        for (int j = 0; j < q.known; ++j) {
+            const unsigned char* col = base + q.pos[j] * Lanes;
+            lo = _mm_and_si128(lo, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(col)), want[j]));
+            hi = _mm_and_si128(hi, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(col + 16)), want[j]));
+        }
+        masks[i] = (uint32_t)_mm_movemask_epi8(lo) | ((uint32_t)_mm_movemask_epi8(hi) << 16);
+    }
+#else
+    for (size_t i = 0; i < n; ++i, base += stride) {
+        uint32_t m = ~0u;
+        for (int j = 0; j < q.known && m; ++j) {
+            const unsigned char* col = base + q.pos[j] * Lanes;
+            uint32_t eq = 0;
+            for (int lane = 0; lane < Lanes; ++lane) eq |= (uint32_t)(col[lane] == q.letter[j]) << lane;
+            m &= eq;
+        }
+        masks[i] = m;
+    }
+#endif
+    // lanes past the last word are zero, which no letter matches, but an all-wildcard
+    // pattern still has to be cut off there
+    size_t end = first + n;
+    if (end == b.blocks && b.count % Lanes) masks[n - 1] &= (1u << (b.count % Lanes)) - 1;
+    return n;
+}
+
+size_t PackedWords::countWithPattern(const std::string& pattern) const {
+    Query q;
+    if (!prepare(pattern, q)) return 0;
+    const Bucket& b = buckets[q.length];
+    if (q.known == 0) return b.count;
+    size_t total = 0;
+    uint32_t masks[ChunkBlocks];
+    for (size_t block = 0; block < b.blocks; block += ChunkBlocks) {
+        size_t n = scan(b, q, block, masks);
+        for (size_t i = 0; i < n; ++i) total += popcount32(masks[i]);
+    }
+    return total;
+}
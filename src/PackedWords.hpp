@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Brute-force pattern matcher, an alternative to walking the Trie for short slots. Words
+// of each length are stored column-wise in blocks of Lanes words: for every position the
+// block holds the Lanes letters at that position side by side, so one vector compare tests
+// a pattern letter against a whole block (AVX2: 32 words per compare, SSE2: 16, otherwise
+// a scalar loop over the same layout). A block's match mask is the AND of the compares for
+// the pattern's known letters; wildcards cost nothing. Matches come out in the order the
+// words were given, so a sorted list gives the same order as the trie.
+class PackedWords {
+public:
+    static constexpr int Lanes = 32;
+    static constexpr int MaxLength = 31; // longer words are not stored
+
+    // words must be uppercase A-Z; only lengths whose bit is set in lengthMask are kept
+    void build(const std::vector<std::string>& words, uint32_t lengthMask = ~0u);
+    void clear() { buckets.clear(); }
+
+    bool has(size_t length) const { return length < buckets.size() && buckets[length].count > 0; }
+    size_t count(size_t length) const { return length < buckets.size() ? buckets[length].count : 0; }
+    size_t memoryBytes() const;
+    // Name of the compare kernel compiled in ("avx2", "sse2" or "scalar")
+    static const char* kernel();
+
+    // Same pattern rules as Trie: letters (any case), '_' or '?' for unknown; any other
+    // character matches nothing.
+    size_t countWithPattern(const std::string& pattern) const;
+
+    // Call f(std::string_view word) for every match in stored order; f returns false to
+    // stop. Returns false if f stopped the scan.
+    template <typename F>
+    bool visitWithPattern(const std::string& pattern, F&& f) const {
+        Query q;
+        if (!prepare(pattern, q)) return true;
+        const Bucket& b = buckets[q.length];
+        uint32_t masks[ChunkBlocks];
+        for (size_t block = 0; block < b.blocks; block += ChunkBlocks) {
+            size_t n = scan(b, q, block, masks);
+            for (size_t i = 0; i < n; ++i) {
+                for (uint32_t m = masks[i]; m; m &= m - 1) {
+                    size_t id = (block + i) * Lanes + lowestBit(m);
+                    if (!f(std::string_view(b.rows.data() + id * q.length, q.length))) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t ChunkBlocks = 64; // masks produced per kernel call
+
+    struct Bucket {
+        size_t count = 0;
+        size_t blocks = 0;
+        std::vector<char> rows;          // count * length letters, word after word
+        std::vector<unsigned char> cols; // [(block * length + pos) * Lanes + lane], 0 past count
+    };
+    struct Query {
+        size_t length = 0;
+        int known = 0;
+        unsigned char pos[MaxLength];
+        unsigned char letter[MaxLength];
+    };
+
+    std::vector<Bucket> buckets; // indexed by word length
+
+    bool prepare(const std::string& pattern, Query& q) const; // false: nothing can match
+    // Match masks of blocks [first, first + ChunkBlocks) into masks; returns how many
+    size_t scan(const Bucket& b, const Query& q, size_t first, uint32_t* masks) const;
+
+    static int lowestBit(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctz(x);
+#else
+        int i = 0;
+        while (!(x & 1u)) { x >>= 1; ++i; }
+        return i;
+#endif
+    }
+};
@@ -16,7 +16,8 @@ void PuzzleBrowser::refresh() {
     for (const auto& entry : fs::directory_iterator(puzzleDir)) {
         if (entry.is_regular_file()) {
             std::string name = entry.path().filename().string();
-            if (name.size() > 4 && name.substr(name.size() - 4) == ".txt") {
+            std::string ext = name.size() > 4 ? name.substr(name.size() - 4) : "";
+            if (ext == ".txt" || ext == ".cwp") { // text or binary (CrosswordGrid::loadFromFile)
                 puzzles.push_back(name);
             }
         }
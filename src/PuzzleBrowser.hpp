@@ -12,5 +12,5 @@ public:
 
 private:
     std::string puzzleDir;
-    std::vector<std::string> puzzles; // just filenames (without directory)
+    std::vector<std::string> puzzles; // just filenames (without directory), *.txt and *.cwp
 };
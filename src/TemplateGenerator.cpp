@@ -0,0 +1,215 @@
+#include "TemplateGenerator.hpp"
+#include "GridBits.hpp"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+void TemplateGenerator::setDictionary(const WordIndex& words) {
+    wordCounts.assign(words.maxLength() + 1, 0);
+    for (int len = 1; len <= words.maxLength(); ++len) wordCounts[len] = words.count(len);
+}
+
+bool TemplateGenerator::generate(CrosswordGrid& grid) {
+    const int R = options.rows, C = options.cols;
+    if (grid.rows != R || grid.cols != C) grid = CrosswordGrid(R, C);
+    const int n = R * C;
+
+    bool ok = false;
+    int bestBlocks = -1;
+    int minBlocks = (int)std::lround(std::max(0.0, options.density - options.densityTolerance) * n);
+    // a line shorter than minLength could only be fully blocked, which breaks connectivity
+    bool possible = n > 0 && (options.minLength <= 1 || (R >= options.minLength && C >= options.minLength));
+    if (possible) {
+        withGridBits(R, C, [&](auto open) {
+            auto masks = open.rowMasks(options.minLength);
+            for (int a = 0; a < options.maxAttempts; ++a) {
+                ++stats.attempts;
+                int blocks = attempt(open, masks);
+                if (blocks < 0) continue;
+                if (blocks >= minBlocks) {
+                    ok = true;
+                    break;
+                }
+                ++stats.shortOfDensity;
+                if (blocks > bestBlocks) {
+                    bestBlocks = blocks;
+                    best = blocked;
+                }
+            }
+        });
+    }
+    if (!ok && bestBlocks >= 0) {
+        blocked.swap(best);
+        ok = true;
+    }
+    if (!ok) blocked.assign(n, 0);
+
+    for (int r = 0; r < R; ++r)
+        for (int c = 0; c < C; ++c)
+            grid.setBlocked(r, c, blocked[r * C + c] != 0);
+    grid.recomputeClueNumbers();
+    return ok;
+}
+
+template <typename Bits>
+int TemplateGenerator::attempt(Bits& open, const std::vector<Bits>& masks) {
+    const int n = options.rows * options.cols;
+    blocked.assign(n, 0);
+    open.fill();
+
+    // only one cell of every symmetric pair is a candidate; setPair blocks both
+    order.clear();
+    for (int cell = 0; cell < n; ++cell)
+        if (!options.symmetric || cell <= mirror(cell)) order.push_back(cell);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    int target = (int)std::lround(options.density * n);
+    int blocks = 0;
+    for (int cell : order) {
+        if (blocks >= target) break;
+        int added = setPair(cell, 1, open);
+        if (added && acceptable(cell, open, masks)) blocks += added;
+        else setPair(cell, 0, open);
+    }
+
+    if (!repairLengths(blocks, open, masks) || !histogramFits()) {
+        ++stats.rejectedDictionary;
+        return -1;
+    }
+    return blocks;
+}
+
+template <typename Bits>
+int TemplateGenerator::setPair(int cell, char value, Bits& open) {
+    int changed = 0;
+    if (blocked[cell] != value) { blocked[cell] = value; open.assign(cell, !value); ++changed; }
+    if (options.symmetric) {
+        int m = mirror(cell);
+        if (blocked[m] != value) { blocked[m] = value; open.assign(m, !value); ++changed; }
+    }
+    return changed;
+}
+
+template <typename Bits>
+bool TemplateGenerator::acceptable(int cell, const Bits& open, const std::vector<Bits>& masks) const {
+    // every earlier block kept all runs long enough, so checking the whole grid only finds
+    // the runs through cell (and its mirror)
+    if (!open.runsAtLeast(options.minLength, masks)) return false;
+    // the pattern was connected before cell (and its mirror) got blocked; removing a cell
+    // with at most one open neighbour cannot split it, so skip the flood fill
+    if (open.none()) return false;
+    if (openNeighbours(cell) <= 1 && (!options.symmetric || openNeighbours(mirror(cell)) <= 1)) return true;
+    return open.connected(masks);
+}
+
+int TemplateGenerator::openNeighbours(int cell) const {
+    const int R = options.rows, C = options.cols;
+    int r = cell / C, c = cell % C;
+    return (r > 0 && !blocked[cell - C]) + (r + 1 < R && !blocked[cell + C]) +
+           (c > 0 && !blocked[cell - 1]) + (c + 1 < C && !blocked[cell + 1]);
+}
+
+bool TemplateGenerator::lengthSupported(int length) const {
+    if (wordCounts.empty() || length < 2) return true;
+    return length < (int)wordCounts.size() && wordCounts[length] > 0;
+}
+
+template <typename Bits>
+bool TemplateGenerator::repairLengths(int& blocks, Bits& open, const std::vector<Bits>& masks) {
+    // split every run whose length has no words with an extra block (pair) inside it
+    if (wordCounts.empty()) return true;
+    const int R = options.rows, C = options.cols;
+    for (;;) {
+        int runStart = -1, runStep = 0, runLen = 0;
+        for (int line = 0; line < R + C && runStart < 0; ++line) {
+            bool across = line < R;
+            int start = across ? line * C : line - R;
+            int step = across ? 1 : C;
+            int count = across ? C : R;
+            int run = 0;
+            for (int i = 0; i <= count; ++i) {
+                if (i < count && !blocked[start + i * step]) { ++run; continue; }
+                if (run > 0 && !lengthSupported(run)) {
+                    runStart = start + (i - run) * step;
+                    runStep = step;
+                    runLen = run;
+                    break;
+                }
+                run = 0;
+            }
+        }
+        if (runStart < 0) return true;
+
+        bool split = false;
+        int offset = (int)(rng() % (unsigned)runLen);
+        for (int k = 0; k < runLen && !split; ++k) {
+            int cell = runStart + ((offset + k) % runLen) * runStep;
+            int added = setPair(cell, 1, open);
+            if (added && acceptable(cell, open, masks)) {
+                blocks += added;
+                split = true;
+            } else {
+                setPair(cell, 0, open);
+            }
+        }
+        if (!split) return false;
+    }
+}
+
+bool TemplateGenerator::histogramFits() {
+    if (wordCounts.empty()) return true;
+    const int R = options.rows, C = options.cols;
+    histogram.assign(std::max(R, C) + 1, 0);
+    for (int line = 0; line < R + C; ++line) {
+        bool across = line < R;
+        int start = across ? line * C : line - R;
+        int step = across ? 1 : C;
+        int count = across ? C : R;
+        int run = 0;
+        for (int i = 0; i <= count; ++i) {
+            if (i < count && !blocked[start + i * step]) { ++run; continue; }
+            if (run >= 2) ++histogram[run];
+            run = 0;
+        }
+    }
+    for (size_t len = 2; len < histogram.size(); ++len) {
+        if (histogram[len] == 0) continue;
+        if (len >= wordCounts.size() || wordCounts[len] < (size_t)histogram[len]) return false;
+    }
+    return true;
+}
+
+void randomizeBlockedCells(CrosswordGrid& grid, double blockDensity, unsigned seed) {
+    // Clamp density to [0, 1]
+    if (blockDensity < 0.0) blockDensity = 0.0;
+    if (blockDensity > 1.0) blockDensity = 1.0;
+
+    // Symmetric, connected pattern without runs shorter than 3 (falls back to an open grid
+    // when the size makes that impossible)
+    TemplateGenerator::Options opt;
+    opt.rows = grid.rows;
+    opt.cols = grid.cols;
+    opt.density = blockDensity;
+    TemplateGenerator templates(opt);
+    templates.setSeed(seed ? seed : static_cast<unsigned>(std::time(nullptr)));
+    templates.generate(grid);
+}
+
+bool TemplateGenerator::fitsDictionary(const CrosswordGrid& grid, const WordIndex& words) {
+    std::vector<int> slotsOfLength(std::max(grid.rows, grid.cols) + 1, 0);
+    for (int line = 0; line < grid.rows + grid.cols; ++line) {
+        bool across = line < grid.rows;
+        int count = across ? grid.cols : grid.rows;
+        int run = 0;
+        for (int i = 0; i <= count; ++i) {
+            int r = across ? line : i;
+            int c = across ? i : line - grid.rows;
+            if (i < count && !grid.isBlocked(r, c)) { ++run; continue; }
+            if (run >= 2) ++slotsOfLength[run];
+            run = 0;
+        }
+    }
+    for (size_t len = 2; len < slotsOfLength.size(); ++len)
+        if (slotsOfLength[len] > 0 && words.count((int)len) < (size_t)slotsOfLength[len]) return false;
+    return true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <random>
+#include <vector>
+#include "CrosswordGrid.hpp"
+#include "WordIndex.hpp"
+
+// Builds block patterns that are worth handing to Generator: every run of open cells is
+// at least minLength long, the open cells form one connected region, the pattern is
+// (optionally) symmetric under 180-degree rotation, and the block count is close to the
+// target density. With a dictionary attached, templates whose slot-length histogram the
+// dictionary cannot cover are repaired or thrown away before any fill is attempted.
+class TemplateGenerator {
+public:
+    struct Options {
+        int rows = 15, cols = 15;
+        double density = 0.17;         // target fraction of blocked cells
+        double densityTolerance = 0.05; // accept anything at least density - tolerance
+        int minLength = 3;             // shortest allowed run of open cells
+        bool symmetric = true;         // 180-degree rotational symmetry
+        int maxAttempts = 64;          // fresh patterns tried before generate() gives up
+    };
+
+    struct Stats {
+        unsigned long long attempts = 0;
+        unsigned long long shortOfDensity = 0;     // attempts that fell short of the target
+        unsigned long long rejectedDictionary = 0; // slot lengths the dictionary cannot cover
+    };
+
+    TemplateGenerator() = default;
+    explicit TemplateGenerator(const Options& opt) : options(opt) {}
+
+    void setOptions(const Options& opt) { options = opt; }
+    const Options& getOptions() const { return options; }
+    void setSeed(unsigned s) { rng.seed(s); }
+
+    // Words available per length (index = length). Without this only the shape rules apply.
+    void setWordCounts(std::vector<size_t> counts) { wordCounts = std::move(counts); }
+    void setDictionary(const WordIndex& words);
+
+    // Block cells of grid (resized to options.rows x options.cols) to a valid template and
+    // renumber it. Letters are cleared. If no attempt reaches the density target the densest
+    // valid one is used. Returns false if every attempt was rejected; the grid is left
+    // fully open in that case.
+    bool generate(CrosswordGrid& grid);
+    const Stats& getStats() const { return stats; }
+
+    // Cheap pre-fill check for any grid: every slot length has words, and at least as many
+    // distinct words as there are slots of that length.
+    static bool fitsDictionary(const CrosswordGrid& grid, const WordIndex& words);
+
+private:
+    Options options;
+    Stats stats;
+    std::mt19937 rng{std::random_device{}()};
+    std::vector<size_t> wordCounts;
+
+    // Scratch reused between attempts so steady-state generation does not allocate
+    std::vector<char> blocked;   // row-major
+    std::vector<int> order;      // canonical cells in random order
+    std::vector<int> histogram;  // slots per length
+    std::vector<char> best;      // densest valid pattern that missed the density target
+
+    // The run and connectivity tests work on a GridBits of the open cells, kept in step with
+    // blocked; Bits is fixed-size for the standard grid sizes (see withGridBits)
+    template <typename Bits>
+    int attempt(Bits& open, const std::vector<Bits>& masks); // blocks placed, or -1 if rejected
+    template <typename Bits>
+    int setPair(int cell, char value, Bits& open); // cells changed
+    template <typename Bits>
+    bool acceptable(int cell, const Bits& open, const std::vector<Bits>& masks) const;
+    template <typename Bits>
+    bool repairLengths(int& blocks, Bits& open, const std::vector<Bits>& masks);
+    int mirror(int cell) const { return options.rows * options.cols - 1 - cell; }
+    int openNeighbours(int cell) const;
+    bool lengthSupported(int length) const;
+    bool histogramFits();
+};
+
+// Block cells of grid at random with the given density (clamped to 0.0-1.0) using
+// TemplateGenerator's default shape rules. Also resets all letters to empty and renumbers.
+// seed 0 seeds from the clock.
+void randomizeBlockedCells(CrosswordGrid& grid, double blockDensity = 0.2, unsigned seed = 0);
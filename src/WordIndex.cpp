@@ -0,0 +1,106 @@
+#include "WordIndex.hpp"
+#include <algorithm>
+
+namespace {
+inline int popcount64(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+}
+
+int WordIndex::countTrailingZeros(Block x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) { x >>= 1; ++n; }
+    return n;
+#endif
+}
+
+void WordIndex::clear() {
+    buckets.clear();
+}
+
+void WordIndex::build(const std::vector<std::string>& words) {
+    clear();
+    size_t maxLen = 0;
+    for (const auto& w : words) maxLen = std::max(maxLen, w.size());
+    buckets.resize(maxLen + 1);
+    for (const auto& w : words)
+        if (!w.empty()) buckets[w.size()].words.push_back(w);
+
+    for (size_t len = 1; len < buckets.size(); ++len) {
+        Bucket& b = buckets[len];
+        if (b.words.empty()) continue;
+        b.blocks = (b.words.size() + BlockBits - 1) / BlockBits;
+        b.postings.assign(len * 26 * b.blocks, 0);
+        b.all.assign(b.blocks, 0);
+        for (size_t id = 0; id < b.words.size(); ++id) {
+            Block bit = Block(1) << (id % BlockBits);
+            size_t blk = id / BlockBits;
+            b.all[blk] |= bit;
+            for (size_t k = 0; k < len; ++k) {
+                int letter = b.words[id][k] - 'A';
+                if (letter < 0 || letter >= 26) continue;
+                b.postings[(k * 26 + letter) * b.blocks + blk] |= bit;
+            }
+        }
+    }
+}
+
+size_t WordIndex::count(int length) const {
+    if (length <= 0 || length >= (int)buckets.size()) return 0;
+    return buckets[length].words.size();
+}
+
+size_t WordIndex::blocks(int length) const {
+    if (length <= 0 || length >= (int)buckets.size()) return 0;
+    return buckets[length].blocks;
+}
+
+const WordIndex::Block* WordIndex::posting(int length, int pos, char letter) const {
+    const Bucket& b = buckets[length];
+    return b.postings.data() + ((size_t)pos * 26 + (letter - 'A')) * b.blocks;
+}
+
+const WordIndex::Block* WordIndex::all(int length) const {
+    return buckets[length].all.data();
+}
+
+size_t WordIndex::match(const std::string& pattern, Block* out) const {
+    int len = (int)pattern.size();
+    size_t n = blocks(len);
+    if (n == 0) return 0;
+    std::copy(all(len), all(len) + n, out);
+    size_t matches = count(len);
+    for (int k = 0; k < len; ++k) {
+        char ch = pattern[k];
+        if (ch == ' ' || ch == '_' || ch == '?') continue;
+        if (ch < 'A' || ch > 'Z') { std::fill(out, out + n, 0); return 0; }
+        matches = andCount(out, posting(len, k, ch), n);
+        if (matches == 0) break;
+    }
+    return matches;
+}
+
+size_t WordIndex::andCount(Block* dst, const Block* src, size_t n) {
+    size_t total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] &= src[i];
+        total += popcount64(dst[i]);
+    }
+    return total;
+}
+
+size_t WordIndex::popcount(const Block* p, size_t n) {
+    size_t total = 0;
+    for (size_t i = 0; i < n; ++i) total += popcount64(p[i]);
+    return total;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Posting-list index over a word list. Words are bucketed by length and get ids local
+// to their bucket; for every (length, position, letter) the index keeps a bitset of the
+// ids whose word has that letter at that position. Candidates for a partially filled
+// slot are the AND of the postings of its known letters.
+class WordIndex {
+public:
+    using Block = std::uint64_t;
+    static constexpr int BlockBits = 64;
+
+    // words must already be normalized to uppercase A-Z
+    void build(const std::vector<std::string>& words);
+    void clear();
+
+    int maxLength() const { return (int)buckets.size() - 1; }
+    size_t count(int length) const;
+    size_t blocks(int length) const;                 // bitset size in Blocks
+    const std::string& word(int length, uint32_t id) const { return buckets[length].words[id]; }
+    const Block* posting(int length, int pos, char letter) const;
+    const Block* all(int length) const;              // every id of this length
+
+    // Write the ids of words matching pattern (' ', '_' or '?' for unknown) into out,
+    // which must hold blocks(pattern.size()) Blocks. Returns the number of matches.
+    size_t match(const std::string& pattern, Block* out) const;
+
+    // Bitset kernels. Plain counted loops so the compiler can vectorize them
+    // (SSE2 by default, AVX2/POPCNT with -mavx2 -mpopcnt).
+    static size_t andCount(Block* dst, const Block* src, size_t n); // dst &= src, returns popcount
+    static size_t popcount(const Block* p, size_t n);
+
+    // Call f(id) for every set bit, in ascending id order
+    template <typename F>
+    static void forEachSet(const Block* p, size_t n, F&& f) {
+        for (size_t b = 0; b < n; ++b) {
+            Block bits = p[b];
+            while (bits) {
+                f((uint32_t)(b * BlockBits + countTrailingZeros(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+private:
+    struct Bucket {
+        std::vector<std::string> words;
+        size_t blocks = 0;
+        std::vector<Block> postings; // [(pos * 26 + letter) * blocks + block]
+        std::vector<Block> all;
+    };
+
+    std::vector<Bucket> buckets; // indexed by word length
+
+    static int countTrailingZeros(Block x);
+};
@@ -0,0 +1,350 @@
+// Headless batch generator: fills many grids without opening a window. Every filled grid
+// is written with CrosswordGrid::saveToFile (text, or binary with --format cwp), and every
+// attempt gets one line in <out>/stats.jsonl. Does not depend on SFML.
+//
+//   crossword_batch --dict FILE (--templates DIR | --random ROWSxCOLS[:DENSITY])
+//                   [--count N] [--threads T] [--out DIR] [--strategy mrv|static] [--seed S]
+//                   [--max-nodes N] [--max-seconds S] [--min-length N] [--format txt|cwp]
+//   crossword_batch --dict FILE --compile-dict IMAGE
+//   crossword_batch --dict FILE --check PUZZLES
+//   crossword_batch --convert IN OUT
+//   crossword_batch --info PUZZLE
+//
+// --random patterns come from TemplateGenerator (symmetric, connected, no run shorter than
+// --min-length). Templates whose slot lengths the dictionary cannot cover are skipped
+// without a fill attempt.
+//
+// --compile-dict builds the minimized dictionary graph once and writes it as a binary
+// image that Trie::mapImage can map instead of parsing the word list at startup.
+//
+// --check re-checks every slot of a puzzle, or of every puzzle in a directory, against the
+// dictionary in one Trie::countWithPatterns batch per grid, and lists the slots no word
+// fits (a filled slot that is not a word, or a partial one with no completion). Exits with
+// 1 if it found any.
+//
+// --convert rewrites a puzzle between the text and the binary (.cwp) format, each picked by
+// file extension. --info checks a binary puzzle from its header alone and prints it.
+
+#include "CrosswordGrid.hpp"
+#include "Generator.hpp"
+#include "PuzzleBrowser.hpp"
+#include "trie.hpp"
+#include "TemplateGenerator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    std::string dictPath;
+    std::string compilePath;
+    std::string checkPath;
+    std::string convertIn, convertOut;
+    std::string infoPath;
+    std::string format = "txt";
+    std::string templateDir;
+    int rows = 0, cols = 0;
+    double density = 0.2;
+    int minLength = 3;
+    int count = 1;
+    int threads = 0;
+    std::string outDir = "batch_out";
+    Generator::Strategy strategy = Generator::Strategy::MostConstrained;
+    unsigned seed = 0;
+    unsigned long long maxNodes = 0;
+    double maxSeconds = 0.0;
+};
+
+void printUsage() {
+    std::cerr << "Usage: crossword_batch --dict FILE (--templates DIR | --random ROWSxCOLS[:DENSITY])\n"
+                 "                       [--count N] [--threads T] [--out DIR] [--strategy mrv|static] [--seed S]\n"
+                 "                       [--max-nodes N] [--max-seconds S] [--min-length N] [--format txt|cwp]\n"
+                 "       crossword_batch --dict FILE --compile-dict IMAGE\n"
+                 "       crossword_batch --dict FILE --check PUZZLES\n"
+                 "       crossword_batch --convert IN OUT\n"
+                 "       crossword_batch --info PUZZLE\n";
+}
+
+bool parseRandomSpec(const std::string& spec, Options& opt) {
+    // ROWSxCOLS or ROWSxCOLS:DENSITY
+    size_t x = spec.find('x');
+    if (x == std::string::npos) return false;
+    size_t colon = spec.find(':', x);
+    opt.rows = std::atoi(spec.substr(0, x).c_str());
+    opt.cols = std::atoi(spec.substr(x + 1, colon == std::string::npos ? std::string::npos : colon - x - 1).c_str());
+    if (colon != std::string::npos) opt.density = std::atof(spec.substr(colon + 1).c_str());
+    return opt.rows > 0 && opt.cols > 0;
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string val = argv[++i];
+        if (arg == "--convert") {
+            if (i + 1 >= argc) return false;
+            opt.convertIn = val;
+            opt.convertOut = argv[++i];
+        }
+        else if (arg == "--info") opt.infoPath = val;
+        else if (arg == "--format") {
+            if (val != "txt" && val != "cwp") return false;
+            opt.format = val;
+        }
+        else if (arg == "--dict") opt.dictPath = val;
+        else if (arg == "--templates") opt.templateDir = val;
+        else if (arg == "--random") { if (!parseRandomSpec(val, opt)) return false; }
+        else if (arg == "--count") opt.count = std::atoi(val.c_str());
+        else if (arg == "--threads") opt.threads = std::atoi(val.c_str());
+        else if (arg == "--out") opt.outDir = val;
+        else if (arg == "--seed") opt.seed = (unsigned)std::strtoul(val.c_str(), nullptr, 10);
+        else if (arg == "--max-nodes") opt.maxNodes = std::strtoull(val.c_str(), nullptr, 10);
+        else if (arg == "--max-seconds") opt.maxSeconds = std::atof(val.c_str());
+        else if (arg == "--min-length") opt.minLength = std::atoi(val.c_str());
+        else if (arg == "--compile-dict") opt.compilePath = val;
+        else if (arg == "--check") opt.checkPath = val;
+        else if (arg == "--strategy") {
+            if (val == "mrv") opt.strategy = Generator::Strategy::MostConstrained;
+            else if (val == "static") opt.strategy = Generator::Strategy::StaticOrder;
+            else return false;
+        }
+        else return false;
+    }
+    if (!opt.convertIn.empty() || !opt.infoPath.empty()) return true;
+    if (opt.dictPath.empty() || opt.count <= 0) return false;
+    if (!opt.compilePath.empty() || !opt.checkPath.empty()) return true;
+    return !opt.templateDir.empty() || opt.rows > 0;
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') out.push_back('\\');
+        out.push_back(ch);
+    }
+    return out;
+}
+
+// One pattern per slot, in slot order, '_' for empty cells
+std::vector<std::string> slotPatterns(const CrosswordGrid& grid) {
+    std::vector<std::string> out;
+    for (const auto& s : grid.getSlots()) {
+        CrosswordGrid::SlotView v = grid.slotLetters(s);
+        std::string p(v.length, '_');
+        for (int k = 0; k < v.length; ++k) if (v[k] != ' ') p[k] = v[k];
+        out.push_back(p);
+    }
+    return out;
+}
+
+// Slots of the puzzle at path that no word fits; -1 if it does not load
+int checkPuzzle(const Trie& dict, const std::string& path) {
+    CrosswordGrid grid(1, 1);
+    if (!grid.loadFromFile(path)) {
+        std::cerr << "Failed to load puzzle: " << path << std::endl;
+        return -1;
+    }
+    std::vector<std::string> patterns = slotPatterns(grid);
+    std::vector<size_t> counts = dict.countWithPatterns(patterns);
+    int bad = 0;
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        if (counts[i] > 0) continue;
+        const auto& s = grid.getSlots()[i];
+        bool full = patterns[i].find('_') == std::string::npos;
+        std::printf("%s: %d %s %s: %s\n", path.c_str(), s.clueNumber, s.across ? "across" : "down",
+                    patterns[i].c_str(), full ? "not in the dictionary" : "no word fits");
+        ++bad;
+    }
+    return bad;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        printUsage();
+        return 1;
+    }
+
+    if (!opt.convertIn.empty()) {
+        CrosswordGrid grid(1, 1);
+        if (!grid.loadFromFile(opt.convertIn)) {
+            std::cerr << "Failed to load puzzle: " << opt.convertIn << std::endl;
+            return 1;
+        }
+        if (!grid.saveToFile(opt.convertOut)) {
+            std::cerr << "Failed to write " << opt.convertOut << std::endl;
+            return 1;
+        }
+        std::cerr << "Wrote " << opt.convertOut << ": " << grid.rows << "x" << grid.cols << ", "
+                  << grid.getSlots().size() << " slots" << std::endl;
+        return 0;
+    }
+
+    if (!opt.infoPath.empty()) {
+        CrosswordGrid::PuzzleInfo info;
+        if (!CrosswordGrid::readPuzzleInfo(opt.infoPath, info)) {
+            std::cerr << "Not a valid binary puzzle: " << opt.infoPath << std::endl;
+            return 1;
+        }
+        std::printf("%dx%d, %d open cells, %d slots, %s\n", info.rows, info.cols, info.openCells,
+                    info.slotCount, info.hasLetters ? "with letters" : "no letters");
+        return 0;
+    }
+
+    if (!opt.compilePath.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        Trie dict;
+        if (!dict.loadFromFile(opt.dictPath, true)) {
+            std::cerr << "Failed to open dictionary: " << opt.dictPath << std::endl;
+            return 1;
+        }
+        std::string error;
+        if (!dict.saveImage(opt.compilePath, &error)) {
+            std::cerr << "Failed to write " << opt.compilePath << ": " << error << std::endl;
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << "Wrote " << opt.compilePath << ": " << dict.nodeCount() << " nodes, "
+                  << dict.memoryBytes() << " bytes in " << seconds << "s" << std::endl;
+        return 0;
+    }
+
+    if (!opt.checkPath.empty()) {
+        Trie dict;
+        if (!dict.loadFromFile(opt.dictPath, true)) {
+            std::cerr << "Failed to open dictionary: " << opt.dictPath << std::endl;
+            return 1;
+        }
+        std::vector<std::string> paths;
+        if (fs::is_directory(opt.checkPath)) {
+            PuzzleBrowser browser(opt.checkPath);
+            for (int i = 0; i < browser.count(); ++i) paths.push_back(browser.getFullPath(i));
+        } else {
+            paths.push_back(opt.checkPath);
+        }
+        int bad = 0, failed = 0;
+        for (const auto& path : paths) {
+            int n = checkPuzzle(dict, path);
+            if (n < 0) ++failed;
+            else bad += n;
+        }
+        std::cerr << "Checked " << paths.size() - failed << " puzzles, " << bad << " slots that no word fits" << std::endl;
+        return bad > 0 || failed > 0 ? 1 : 0;
+    }
+
+    // Index the dictionary once; every worker searches the same read-only index. The list is
+    // read by the same parser as the GUI's (scores, ';' and ',' separators), and the index
+    // built from the same alphabetical word set.
+    Generator shared;
+    {
+        Trie dict;
+        if (!dict.loadFromFile(opt.dictPath, true)) {
+            std::cerr << "Failed to open dictionary: " << opt.dictPath << std::endl;
+            return 1;
+        }
+        shared.loadWords(dict.allWords());
+    }
+
+    std::vector<std::string> templates;
+    if (!opt.templateDir.empty()) {
+        PuzzleBrowser browser(opt.templateDir);
+        for (int i = 0; i < browser.count(); ++i) templates.push_back(browser.getFullPath(i));
+        if (templates.empty()) {
+            std::cerr << "No templates (*.txt, *.cwp) found in " << opt.templateDir << std::endl;
+            return 1;
+        }
+    }
+
+    std::error_code ec;
+    fs::create_directories(opt.outDir, ec);
+    std::ofstream statsOut(opt.outDir + "/stats.jsonl");
+    if (!statsOut) {
+        std::cerr << "Failed to write " << opt.outDir << "/stats.jsonl" << std::endl;
+        return 1;
+    }
+
+    int threads = opt.threads > 0 ? opt.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    unsigned baseSeed = opt.seed ? opt.seed : std::random_device{}();
+    std::atomic<int> next{0};
+    std::atomic<int> filled{0};
+    std::mutex outMutex;
+    auto batchStart = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        Generator gen;
+        gen.useWords(shared.getWords());
+        gen.setStrategy(opt.strategy);
+        gen.setBudget(opt.maxNodes, opt.maxSeconds);
+        TemplateGenerator::Options shape;
+        shape.rows = opt.rows;
+        shape.cols = opt.cols;
+        shape.density = opt.density;
+        shape.minLength = opt.minLength;
+        TemplateGenerator templateGen(shape);
+        templateGen.setDictionary(*shared.getWords());
+        for (int i = next++; i < opt.count; i = next++) {
+            unsigned seed = baseSeed + (unsigned)i;
+            CrosswordGrid grid(opt.rows > 0 ? opt.rows : 1, opt.cols > 0 ? opt.cols : 1);
+            std::string source = "random";
+            bool loaded = true;
+            if (!templates.empty()) {
+                source = templates[i % templates.size()];
+                loaded = grid.loadFromFile(source);
+            } else {
+                templateGen.setSeed(seed);
+                loaded = templateGen.generate(grid);
+            }
+            // reject before the search if some slot length has too few words
+            bool fits = loaded && TemplateGenerator::fitsDictionary(grid, *shared.getWords());
+
+            gen.setSeed(seed);
+            auto start = std::chrono::steady_clock::now();
+            bool ok = fits && gen.generate(grid);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::string path;
+            if (ok) {
+                char name[32];
+                std::snprintf(name, sizeof(name), "puzzle_%05d.%s", i + 1, opt.format.c_str());
+                path = opt.outDir + "/" + name;
+                if (!grid.saveToFile(path)) path.clear();
+            }
+            Generator::Stats st = fits ? gen.getStats() : Generator::Stats();
+            std::lock_guard<std::mutex> lock(outMutex);
+            statsOut << "{\"index\":" << i + 1
+                     << ",\"template\":\"" << jsonEscape(source) << "\""
+                     << ",\"file\":\"" << jsonEscape(path) << "\""
+                     << ",\"success\":" << (ok ? "true" : "false")
+                     << ",\"rejected\":" << (loaded && !fits ? "true" : "false")
+                     << ",\"outOfBudget\":" << (st.outOfBudget ? "true" : "false")
+                     << ",\"seconds\":" << seconds
+                     << ",\"nodes\":" << st.nodes
+                     << ",\"backtracks\":" << st.backtracks << "}\n";
+            statsOut.flush();
+            if (ok) ++filled;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+    std::cerr << "Filled " << filled << " of " << opt.count << " puzzles in " << total << "s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,679 @@
+// Benchmarks for the fill search, the dictionary and the grid, kept out of crossword_batch so
+// the shipped tools run on the default allocator. Links AllocCounter.cpp, which counts every
+// heap allocation. Does not depend on SFML.
+//
+//   crossword_bench --dict FILE --verify QUERIES [--seed S]
+//   crossword_bench --dict FILE --match QUERIES [--seed S]
+//   crossword_bench --dict FILE --masks QUERIES [--seed S]
+//   crossword_bench --dict FILE --batch GRIDS [--random ROWSxCOLS[:DENSITY]] [--seed S]
+//   crossword_bench --dict FILE --alloc RUNS [--random ROWSxCOLS[:DENSITY]] [--strategy mrv|static]
+//                   [--max-nodes N] [--min-length N]
+//   crossword_bench --grid PASSES
+//
+// --verify times nothing: it answers the same queries two ways and compares the results,
+// one line per check, with QUERIES setting the size of each. Exits with 1 if any check
+// differs.
+//   - packed scan vs trie walk: every single-pattern query with the PackedWords scan on for
+//     every length, against the graph walk, on QUERIES patterns per length and share of
+//     blank letters cut from words of the dictionary
+//   - masked vs unmasked walk: the words Trie::walkedNodes reaches with the per-node length
+//     masks used and ignored, against countWithPattern, on QUERIES slot patterns per kind
+//   - batched vs single-pattern: countWithPatterns, collectWithPatterns and
+//     visitWithPatterns (also stopped after a few words) on QUERIES batches of 0-60 patterns
+//     with repeats, odd characters and wrong lengths, against one single-pattern call each
+//   - grid slots vs cell reads: the slots of QUERIES random templates against a plain scan
+//     of every row and column, and every SlotView and cellSlots entry against getLetter
+//
+// --match times pattern counts on the trie walk against the PackedWords scan for every word
+// length and share of blank letters (QUERIES patterns each, cut from words of the
+// dictionary), and prints the lengths where the scan wins, as a Trie::usePackedLengths
+// mask. Patterns without blanks are lookups that always walk the trie, so they are left out.
+//
+// --masks walks QUERIES slot patterns per row, cut from words of the dictionary, and prints
+// the trie nodes entered per query with the per-node length masks ignored and used
+// (Trie::walkedNodes), with the time of the real count.
+//
+// --batch fills GRIDS templates (11x11 unless --random is given), blanks 0-90% of their
+// letters and times re-checking every slot one countWithPattern/collectWithPattern call at
+// a time against the batched calls, in us per grid.
+//
+// --alloc fills RUNS grids (an open 6x6 unless --random is given, seeds 1..RUNS, each
+// search stopped after --max-nodes if set) and prints the heap allocations of every
+// generate() call next to its node count. The search reuses stacks reserved up front, so
+// the allocations should stay flat however many nodes a run visits. The first run also sizes
+// the buffers the generator keeps between calls, so the summary leaves it out.
+//
+// --grid times cell access on filled 15x15 and 21x21 templates, in ns per pass: a full
+// getLetter/isBlocked scan and reading every slot, cell by cell or through a SlotView. The
+// "rows" column runs the same passes on a copy kept as a vector of row vectors, the layout
+// the cells had before the flat arrays.
+
+#include "AllocCounter.hpp"
+#include "CrosswordGrid.hpp"
+#include "Generator.hpp"
+#include "trie.hpp"
+#include "TemplateGenerator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string dictPath;
+    int verifyQueries = 0;
+    int matchQueries = 0;
+    int maskQueries = 0;
+    int batchGrids = 0;
+    int allocRuns = 0;
+    int gridPasses = 0;
+    int rows = 0, cols = 0;
+    double density = 0.2;
+    int minLength = 3;
+    Generator::Strategy strategy = Generator::Strategy::MostConstrained;
+    unsigned long long maxNodes = 0;
+    unsigned seed = 1;
+};
+
+void printUsage() {
+    std::cerr << "Usage: crossword_bench --dict FILE --verify QUERIES [--seed S]\n"
+                 "       crossword_bench --dict FILE --match QUERIES [--seed S]\n"
+                 "       crossword_bench --dict FILE --masks QUERIES [--seed S]\n"
+                 "       crossword_bench --dict FILE --batch GRIDS [--random ROWSxCOLS[:DENSITY]] [--seed S]\n"
+                 "       crossword_bench --dict FILE --alloc RUNS [--random ROWSxCOLS[:DENSITY]] [--strategy mrv|static]\n"
+                 "                       [--max-nodes N] [--min-length N]\n"
+                 "       crossword_bench --grid PASSES\n";
+}
+
+bool parseRandomSpec(const std::string& spec, Options& opt) {
+    // ROWSxCOLS or ROWSxCOLS:DENSITY
+    size_t x = spec.find('x');
+    if (x == std::string::npos) return false;
+    size_t colon = spec.find(':', x);
+    opt.rows = std::atoi(spec.substr(0, x).c_str());
+    opt.cols = std::atoi(spec.substr(x + 1, colon == std::string::npos ? std::string::npos : colon - x - 1).c_str());
+    if (colon != std::string::npos) opt.density = std::atof(spec.substr(colon + 1).c_str());
+    return opt.rows > 0 && opt.cols > 0;
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string val = argv[++i];
+        if (arg == "--dict") opt.dictPath = val;
+        else if (arg == "--random") { if (!parseRandomSpec(val, opt)) return false; }
+        else if (arg == "--max-nodes") opt.maxNodes = std::strtoull(val.c_str(), nullptr, 10);
+        else if (arg == "--min-length") opt.minLength = std::atoi(val.c_str());
+        else if (arg == "--seed") opt.seed = (unsigned)std::strtoul(val.c_str(), nullptr, 10);
+        else if (arg == "--verify") opt.verifyQueries = std::atoi(val.c_str());
+        else if (arg == "--match") opt.matchQueries = std::atoi(val.c_str());
+        else if (arg == "--masks") opt.maskQueries = std::atoi(val.c_str());
+        else if (arg == "--batch") opt.batchGrids = std::atoi(val.c_str());
+        else if (arg == "--alloc") opt.allocRuns = std::atoi(val.c_str());
+        else if (arg == "--grid") opt.gridPasses = std::atoi(val.c_str());
+        else if (arg == "--strategy") {
+            if (val == "mrv") opt.strategy = Generator::Strategy::MostConstrained;
+            else if (val == "static") opt.strategy = Generator::Strategy::StaticOrder;
+            else return false;
+        }
+        else return false;
+    }
+    if (opt.gridPasses > 0) return true;
+    if (opt.dictPath.empty()) return false;
+    return opt.verifyQueries > 0 || opt.matchQueries > 0 || opt.maskQueries > 0 || opt.batchGrids > 0 || opt.allocRuns > 0;
+}
+
+bool loadDictionary(const std::string& path, Trie& dict) {
+    if (dict.loadFromFile(path, true)) return true;
+    std::cerr << "Failed to open dictionary: " << path << std::endl;
+    return false;
+}
+
+volatile size_t benchSink = 0;
+
+// Microseconds per countWithPattern call over patterns
+double timeCounts(const Trie& dict, const std::vector<std::string>& patterns) {
+    auto start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    for (const auto& p : patterns) total += dict.countWithPattern(p);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    benchSink = benchSink + total; // keep the counts from being optimized away
+    return patterns.empty() ? 0.0 : us / patterns.size();
+}
+
+// The dictionary's words by length, up to PackedWords::MaxLength
+std::vector<std::vector<std::string>> wordsByLength(const Trie& dict) {
+    std::vector<std::vector<std::string>> byLength(PackedWords::MaxLength + 1);
+    for (auto& w : dict.allWords())
+        if (w.size() <= (size_t)PackedWords::MaxLength) byLength[w.size()].push_back(std::move(w));
+    return byLength;
+}
+
+// count random words of words with every letter blanked with probability blank
+std::vector<std::string> blankedPatterns(const std::vector<std::string>& words, int count, double blank, std::mt19937& rng) {
+    std::vector<std::string> patterns;
+    for (int i = 0; i < count; ++i) {
+        std::string p = words[rng() % words.size()];
+        for (auto& ch : p) if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < blank) ch = '_';
+        patterns.push_back(p);
+    }
+    return patterns;
+}
+
+// Which letters of a word stay known in a slot pattern cut from it
+enum Known { Crossings, Half, NearEnd };
+const char* const KnownNames[] = { "1-2 crossing letters known", "about half the letters known", "one letter near the end" };
+
+// count slot patterns cut from random words of words (all at least 2 letters)
+std::vector<std::string> knownPatterns(const std::vector<std::string>& words, int count, Known known, std::mt19937& rng) {
+    std::vector<std::string> patterns;
+    for (int i = 0; i < count; ++i) {
+        const std::string& w = words[rng() % words.size()];
+        std::string p(w.size(), '_');
+        if (known == Crossings) {
+            for (int n = 1 + (int)(rng() % 2); n > 0; --n) {
+                size_t at = rng() % w.size();
+                p[at] = w[at];
+            }
+        } else if (known == Half) {
+            for (size_t at = 0; at < w.size(); ++at) if (rng() % 2) p[at] = w[at];
+        } else {
+            size_t at = w.size() - 1 - rng() % 2;
+            p[at] = w[at];
+        }
+        patterns.push_back(p);
+    }
+    return patterns;
+}
+
+std::vector<std::string> wordsOfTwoOrMore(const Trie& dict) {
+    std::vector<std::string> words;
+    for (auto& w : dict.allWords())
+        if (w.size() >= 2) words.push_back(std::move(w));
+    return words;
+}
+
+// One --verify line; true if nothing differed
+bool reportCheck(const char* name, size_t queries, size_t differ, const std::string& first) {
+    std::printf("%-34s %9zu queries  %s\n", name, queries, differ ? "DIFFER" : "ok");
+    if (differ) std::printf("  %zu differ, first: %s\n", differ, first.c_str());
+    return differ == 0;
+}
+
+bool verifyPacked(const Trie& walk, int queries, std::mt19937& rng) {
+    Trie scan = walk;
+    scan.usePackedLengths(~0u);
+    size_t total = 0, differ = 0;
+    std::string first;
+    for (const auto& words : wordsByLength(walk)) {
+        if (words.empty()) continue;
+        for (double blank : { 0.0, 0.25, 0.5, 0.75, 1.0 }) {
+            for (const auto& p : blankedPatterns(words, queries, blank, rng)) {
+                ++total;
+                if (scan.countWithPattern(p) == walk.countWithPattern(p) &&
+                    scan.collectWithPattern(p) == walk.collectWithPattern(p) &&
+                    scan.firstWithPattern(p, 3) == walk.firstWithPattern(p, 3) &&
+                    scan.anyWithPattern(p) == walk.anyWithPattern(p))
+                    continue;
+                if (differ++ == 0) first = p;
+            }
+        }
+    }
+    return reportCheck("packed scan vs trie walk", total, differ, first);
+}
+
+bool verifyMasks(const Trie& dict, int queries, std::mt19937& rng) {
+    std::vector<std::string> words = wordsOfTwoOrMore(dict);
+    std::vector<std::string> patterns;
+    for (int known = Crossings; known <= NearEnd && !words.empty(); ++known)
+        for (auto& p : knownPatterns(words, queries, (Known)known, rng)) patterns.push_back(std::move(p));
+    // lengths no word has, where the root mask prunes everything
+    patterns.push_back(std::string(64, '_'));
+    patterns.push_back("_");
+    size_t differ = 0;
+    std::string first;
+    for (const auto& p : patterns) {
+        size_t masked = 0, unmasked = 0;
+        dict.walkedNodes(p, true, &masked);
+        dict.walkedNodes(p, false, &unmasked);
+        size_t count = dict.countWithPattern(p);
+        if (masked == count && unmasked == count) continue;
+        if (differ++ == 0) first = p;
+    }
+    return reportCheck("masked vs unmasked walk", patterns.size(), differ, first);
+}
+
+// A batch of up to 60 patterns cut from words: some whole, most partly blanked with '_' or
+// '?', and some with lowercase or non-letter characters, a letter short, empty, or repeated
+std::vector<std::string> randomBatch(const std::vector<std::string>& words, std::mt19937& rng) {
+    const char odd[] = "_?_?a-b1 ";
+    size_t n = rng() % 4 == 0 ? rng() % 61 : rng() % 12;
+    std::vector<std::string> batch;
+    for (size_t i = 0; i < n; ++i) {
+        std::string p = words[rng() % words.size()];
+        int mode = (int)(rng() % 6);
+        for (auto& ch : p) {
+            unsigned r = rng() % 100;
+            if (mode == 0) continue;
+            if (r < 30) ch = '_';
+            else if (r < 33) ch = odd[rng() % (sizeof(odd) - 1)];
+            else if (r < 40) ch = (char)(ch - 'A' + 'a');
+        }
+        if (mode == 5 && !p.empty()) p.pop_back();
+        if (rng() % 40 == 0) p.clear();
+        if (rng() % 10 == 0 && !batch.empty()) p = batch[rng() % batch.size()];
+        batch.push_back(p);
+    }
+    return batch;
+}
+
+bool verifyBatch(const Trie& dict, int batches, std::mt19937& rng) {
+    std::vector<std::string> words = dict.allWords();
+    if (words.empty()) return reportCheck("batched vs single-pattern", 0, 0, "");
+    size_t total = 0, differ = 0;
+    std::string first;
+    auto note = [&](const std::string& p) { if (differ++ == 0) first = p; };
+    for (int b = 0; b < batches; ++b) {
+        std::vector<std::string> batch = randomBatch(words, rng);
+        std::vector<size_t> counts = dict.countWithPatterns(batch);
+        std::vector<std::vector<std::string>> collected = dict.collectWithPatterns(batch);
+        std::vector<std::vector<std::string>> visited(batch.size());
+        dict.visitWithPatterns(batch, [&](size_t i, std::string_view w) { visited[i].emplace_back(w); return true; });
+        // matches come pattern by pattern, so stopping after k gives the first k of the
+        // single-pattern results in batch order
+        std::vector<std::pair<size_t, std::string>> stopped, expected;
+        size_t k = 1 + rng() % 5;
+        bool finished = dict.visitWithPatterns(batch, [&](size_t i, std::string_view w) {
+            stopped.emplace_back(i, std::string(w));
+            return stopped.size() < k;
+        });
+        for (size_t i = 0; i < batch.size(); ++i) {
+            std::vector<std::string> single = dict.collectWithPattern(batch[i]);
+            ++total;
+            if (counts[i] != dict.countWithPattern(batch[i]) || counts[i] != single.size() || collected[i] != single ||
+                visited[i] != single)
+                note(batch[i]);
+            for (size_t j = 0; j < single.size() && expected.size() < k; ++j) expected.emplace_back(i, single[j]);
+        }
+        if (stopped != expected || finished != (expected.size() < k)) note("stopped batch of " + std::to_string(batch.size()));
+    }
+    return reportCheck("batched vs single-pattern", total, differ, first);
+}
+
+bool verifyGrid(int grids, std::mt19937& rng) {
+    size_t total = 0, differ = 0;
+    std::string first;
+    for (int g = 0; g < grids; ++g) {
+        // the fixed-size bitboards of 5x5, 15x15 and 21x21 as well as runtime-sized ones
+        const int sizes[] = { 5, 15, 21 };
+        TemplateGenerator::Options shape;
+        shape.rows = g % 2 ? sizes[rng() % 3] : 2 + (int)(rng() % 24);
+        shape.cols = g % 2 ? shape.rows : 2 + (int)(rng() % 24);
+        shape.density = (rng() % 40) / 100.0;
+        shape.minLength = 2 + (int)(rng() % 2);
+        TemplateGenerator templateGen(shape);
+        templateGen.setSeed((unsigned)rng());
+        CrosswordGrid grid(shape.rows, shape.cols);
+        templateGen.generate(grid);
+        grid.buildSlots();
+        for (int r = 0; r < grid.rows; ++r)
+            for (int c = 0; c < grid.cols; ++c)
+                if (rng() % 5) grid.setLetter(r, c, (char)('A' + rng() % 26));
+        char name[48];
+        std::snprintf(name, sizeof(name), "%dx%d template %d", grid.rows, grid.cols, g);
+
+        // every run of 2 or more open cells, across by row then down by column
+        std::vector<CrosswordGrid::WordSlot> scanned;
+        for (int line = 0; line < grid.rows + grid.cols; ++line) {
+            bool across = line < grid.rows;
+            int count = across ? grid.cols : grid.rows, run = 0;
+            for (int i = 0; i <= count; ++i) {
+                int r = across ? line : i, c = across ? i : line - grid.rows;
+                if (i < count && !grid.isBlocked(r, c)) { ++run; continue; }
+                if (run >= 2) {
+                    CrosswordGrid::WordSlot s;
+                    s.r = across ? r : i - run;
+                    s.c = across ? i - run : c;
+                    s.length = run;
+                    s.across = across;
+                    s.clueNumber = grid.getClueNumber(s.r, s.c);
+                    scanned.push_back(s);
+                }
+                run = 0;
+            }
+        }
+        const auto& slots = grid.getSlots();
+        bool same = scanned.size() == slots.size();
+        for (size_t i = 0; same && i < slots.size(); ++i)
+            same = scanned[i].r == slots[i].r && scanned[i].c == slots[i].c && scanned[i].length == slots[i].length &&
+                   scanned[i].across == slots[i].across && scanned[i].clueNumber == slots[i].clueNumber;
+        ++total;
+        if (!same && differ++ == 0) first = std::string(name) + ": slots";
+
+        for (size_t id = 0; same && id < slots.size(); ++id) {
+            const auto& s = slots[id];
+            CrosswordGrid::SlotView view = grid.slotLetters((int)id);
+            bool ok = view.length == s.length;
+            for (int k = 0; ok && k < s.length; ++k) {
+                int r = s.across ? s.r : s.r + k, c = s.across ? s.c + k : s.c;
+                const CrosswordGrid::CellSlots& at = grid.slotsAt(r, c);
+                ok = view[k] == grid.getLetter(r, c) && view.cell(k) == grid.index(r, c) &&
+                     (s.across ? at.across == (int)id && at.acrossPos == k : at.down == (int)id && at.downPos == k);
+            }
+            ++total;
+            if (!ok && differ++ == 0) first = std::string(name) + ": slot " + std::to_string(id);
+        }
+    }
+    return reportCheck("grid slots vs cell reads", total, differ, first);
+}
+
+// false if any check differs
+bool verify(const Trie& dict, const Options& opt) {
+    std::mt19937 rng(opt.seed);
+    bool ok = verifyPacked(dict, opt.verifyQueries, rng);
+    ok = verifyMasks(dict, opt.verifyQueries, rng) && ok;
+    ok = verifyBatch(dict, opt.verifyQueries, rng) && ok;
+    ok = verifyGrid(opt.verifyQueries, rng) && ok;
+    return ok;
+}
+
+void benchMatch(const Trie& walk, int queries, unsigned seed) {
+    Trie scan = walk;
+    scan.usePackedLengths(~0u);
+    std::vector<std::vector<std::string>> byLength = wordsByLength(walk);
+
+    const double blanks[] = { 0.25, 0.5, 0.75, 1.0 };
+    std::mt19937 rng(seed);
+    uint32_t mask = 0;
+    std::printf("kernel: %s; us per count, trie / packed, by share of blank letters\n", PackedWords::kernel());
+    std::printf("len    words         25%%                50%%                75%%               100%%\n");
+    for (size_t len = 2; len < byLength.size(); ++len) {
+        const auto& words = byLength[len];
+        if (words.empty()) continue;
+        std::printf("%3zu %8zu", len, words.size());
+        double walkTotal = 0.0, scanTotal = 0.0;
+        for (double blank : blanks) {
+            std::vector<std::string> patterns = blankedPatterns(words, queries, blank, rng);
+            double a = timeCounts(walk, patterns), b = timeCounts(scan, patterns);
+            walkTotal += a;
+            scanTotal += b;
+            std::printf("  %8.2f /%8.2f", a, b);
+        }
+        // a slot under construction goes through every blank level, so weigh them equally
+        if (scanTotal < walkTotal) mask |= 1u << len;
+        std::printf("  %s\n", scanTotal < walkTotal ? "packed" : "trie");
+    }
+    std::printf("usePackedLengths(0x%08x)\n", (unsigned)mask);
+}
+
+void benchMasks(const Trie& dict, int queries, unsigned seed) {
+    std::vector<std::string> words = wordsOfTwoOrMore(dict);
+    if (words.empty()) return;
+
+    std::mt19937 rng(seed);
+    std::printf("%-30s %14s %14s %8s %10s\n", "", "nodes/query", "with masks", "ratio", "us/count");
+    for (int row = Crossings; row <= NearEnd; ++row) {
+        std::vector<std::string> patterns = knownPatterns(words, queries, (Known)row, rng);
+        double off = 0.0, on = 0.0;
+        for (const auto& p : patterns) {
+            off += (double)dict.walkedNodes(p, false);
+            on += (double)dict.walkedNodes(p, true);
+        }
+        std::printf("%-30s %14.0f %14.0f %7.2fx %10.2f\n", KnownNames[row], off / queries, on / queries,
+                    on > 0.0 ? off / on : 0.0, timeCounts(dict, patterns));
+    }
+}
+
+// One pattern per slot, in slot order, '_' for empty cells
+std::vector<std::string> slotPatterns(const CrosswordGrid& grid) {
+    std::vector<std::string> out;
+    for (const auto& s : grid.getSlots()) {
+        CrosswordGrid::SlotView v = grid.slotLetters(s);
+        std::string p(v.length, '_');
+        for (int k = 0; k < v.length; ++k) if (v[k] != ' ') p[k] = v[k];
+        out.push_back(p);
+    }
+    return out;
+}
+
+// Best of three runs of f(grid) over every grid, in us per grid
+template <typename F>
+double usPerGrid(const std::vector<CrosswordGrid>& grids, F&& f) {
+    double best = 0.0;
+    for (int rep = 0; rep < 3; ++rep) {
+        auto start = std::chrono::steady_clock::now();
+        size_t total = 0;
+        for (const auto& g : grids) total += f(g);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        benchSink = benchSink + total;
+        if (rep == 0 || us < best) best = us;
+    }
+    return grids.empty() ? 0.0 : best / grids.size();
+}
+
+void benchBatch(const Generator& shared, const Trie& dict, const Options& opt) {
+    Generator gen;
+    gen.useWords(shared.getWords());
+    gen.setStrategy(opt.strategy);
+    gen.setBudget(opt.maxNodes, 0.0);
+    TemplateGenerator::Options shape;
+    shape.rows = opt.rows > 0 ? opt.rows : 11;
+    shape.cols = opt.cols > 0 ? opt.cols : 11;
+    shape.density = opt.density;
+    shape.minLength = opt.minLength;
+    TemplateGenerator templateGen(shape);
+    templateGen.setDictionary(*shared.getWords());
+
+    std::vector<CrosswordGrid> filled;
+    for (int i = 1; i <= opt.batchGrids; ++i) {
+        CrosswordGrid grid(shape.rows, shape.cols);
+        templateGen.setSeed((unsigned)i);
+        gen.setSeed((unsigned)i);
+        if (templateGen.generate(grid) && gen.generate(grid)) filled.push_back(grid);
+    }
+    std::printf("%zu filled %dx%d grids; us per grid, per slot / batched\n", filled.size(), shape.rows, shape.cols);
+    std::printf("blanked            count                  collect\n");
+
+    std::mt19937 rng(opt.seed);
+    for (int blanked : { 0, 30, 60, 90 }) {
+        std::vector<CrosswordGrid> grids = filled;
+        for (auto& g : grids)
+            for (int r = 0; r < g.rows; ++r)
+                for (int c = 0; c < g.cols; ++c)
+                    if (!g.isBlocked(r, c) && (int)(rng() % 100) < blanked) g.letters[g.index(r, c)] = ' ';
+        std::vector<std::vector<std::string>> patterns;
+        for (const auto& g : grids) patterns.push_back(slotPatterns(g));
+        auto of = [&](const CrosswordGrid& g) -> const std::vector<std::string>& { return patterns[&g - grids.data()]; };
+
+        // the per-slot loops keep every result, as the batched calls return them
+        double countSingle = usPerGrid(grids, [&](const CrosswordGrid& g) {
+            const auto& p = of(g);
+            std::vector<size_t> counts(p.size());
+            size_t total = 0;
+            for (size_t i = 0; i < p.size(); ++i) {
+                counts[i] = dict.countWithPattern(p[i]);
+                total += counts[i];
+            }
+            return total;
+        });
+        double countBatch = usPerGrid(grids, [&](const CrosswordGrid& g) {
+            size_t total = 0;
+            for (size_t n : dict.countWithPatterns(of(g))) total += n;
+            return total;
+        });
+        double collectSingle = usPerGrid(grids, [&](const CrosswordGrid& g) {
+            const auto& p = of(g);
+            std::vector<std::vector<std::string>> words(p.size());
+            size_t total = 0;
+            for (size_t i = 0; i < p.size(); ++i) {
+                words[i] = dict.collectWithPattern(p[i]);
+                total += words[i].size();
+            }
+            return total;
+        });
+        double collectBatch = usPerGrid(grids, [&](const CrosswordGrid& g) {
+            size_t total = 0;
+            for (const auto& words : dict.collectWithPatterns(of(g))) total += words.size();
+            return total;
+        });
+        std::printf("%5d%%  %9.1f / %-9.1f   %9.1f / %-9.1f\n", blanked, countSingle, countBatch, collectSingle,
+                    collectBatch);
+    }
+}
+
+// Best of five timings of passes calls to pass(), in ns per call
+template <typename F>
+double nsPerPass(int passes, F&& pass) {
+    double best = 0.0;
+    for (int rep = 0; rep < 5; ++rep) {
+        auto start = std::chrono::steady_clock::now();
+        size_t total = 0;
+        for (int i = 0; i < passes; ++i) total += pass();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        benchSink = benchSink + total;
+        if (rep == 0 || ns < best) best = ns;
+    }
+    return best / passes;
+}
+
+void benchGrid(int passes) {
+    struct Cell {
+        char letter;
+        bool blocked;
+        bool editable;
+    };
+    std::printf("grid   slots   scan flat   scan rows   slots flat   slots view   slots rows\n");
+    for (int size : { 15, 21 }) {
+        TemplateGenerator::Options shape;
+        shape.rows = shape.cols = size;
+        TemplateGenerator templateGen(shape);
+        templateGen.setSeed(1);
+        CrosswordGrid grid(size, size);
+        templateGen.generate(grid);
+        grid.buildSlots();
+        std::mt19937 rng(1);
+        std::vector<std::vector<Cell>> rows(size, std::vector<Cell>(size));
+        for (int r = 0; r < size; ++r) {
+            for (int c = 0; c < size; ++c) {
+                grid.setLetter(r, c, (char)('A' + rng() % 26));
+                rows[r][c] = { grid.getLetter(r, c), grid.isBlocked(r, c), grid.isEditable(r, c) };
+            }
+        }
+        const auto& slots = grid.getSlots();
+
+        double scanFlat = nsPerPass(passes, [&] {
+            size_t total = 0;
+            for (int r = 0; r < grid.rows; ++r)
+                for (int c = 0; c < grid.cols; ++c)
+                    if (!grid.isBlocked(r, c)) total += (unsigned char)grid.getLetter(r, c);
+            return total;
+        });
+        double scanRows = nsPerPass(passes, [&] {
+            size_t total = 0;
+            for (int r = 0; r < size; ++r)
+                for (int c = 0; c < size; ++c)
+                    if (!rows[r][c].blocked) total += (unsigned char)rows[r][c].letter;
+            return total;
+        });
+        double slotsFlat = nsPerPass(passes, [&] {
+            size_t total = 0;
+            for (const auto& s : slots)
+                for (int k = 0; k < s.length; ++k)
+                    total += (unsigned char)grid.getLetter(s.across ? s.r : s.r + k, s.across ? s.c + k : s.c);
+            return total;
+        });
+        double slotsView = nsPerPass(passes, [&] {
+            size_t total = 0;
+            for (const auto& s : slots) {
+                CrosswordGrid::SlotView v = grid.slotLetters(s);
+                for (int k = 0; k < v.length; ++k) total += (unsigned char)v[k];
+            }
+            return total;
+        });
+        double slotsRows = nsPerPass(passes, [&] {
+            size_t total = 0;
+            for (const auto& s : slots)
+                for (int k = 0; k < s.length; ++k)
+                    total += (unsigned char)(s.across ? rows[s.r][s.c + k] : rows[s.r + k][s.c]).letter;
+            return total;
+        });
+        std::printf("%2dx%-2d %6zu %11.1f %11.1f %12.1f %12.1f %12.1f\n", size, size, slots.size(), scanFlat,
+                    scanRows, slotsFlat, slotsView, slotsRows);
+    }
+}
+
+void benchAlloc(const Generator& shared, const Options& opt) {
+    Generator gen;
+    gen.useWords(shared.getWords());
+    gen.setStrategy(opt.strategy);
+    gen.setBudget(opt.maxNodes, 0.0);
+    TemplateGenerator::Options shape;
+    shape.rows = opt.rows;
+    shape.cols = opt.cols;
+    shape.density = opt.density;
+    shape.minLength = opt.minLength;
+    TemplateGenerator templateGen(shape);
+    templateGen.setDictionary(*shared.getWords());
+
+    std::printf("run  filled        nodes  allocations\n");
+    unsigned long long minAllocs = ~0ull, maxAllocs = 0, minNodes = ~0ull, maxNodes = 0;
+    for (int run = 1; run <= opt.allocRuns; ++run) {
+        CrosswordGrid grid(opt.rows > 0 ? opt.rows : 6, opt.cols > 0 ? opt.cols : 6);
+        templateGen.setSeed((unsigned)run);
+        if (opt.rows > 0 && !templateGen.generate(grid)) continue;
+        gen.setSeed((unsigned)run);
+        unsigned long long before = allocationCount();
+        bool ok = gen.generate(grid);
+        unsigned long long allocs = allocationCount() - before;
+        unsigned long long nodes = gen.getStats().nodes;
+        std::printf("%3d  %6s %12llu %12llu\n", run, ok ? "yes" : "no", nodes, allocs);
+        if (run == 1) continue;
+        minAllocs = std::min(minAllocs, allocs);
+        maxAllocs = std::max(maxAllocs, allocs);
+        minNodes = std::min(minNodes, nodes);
+        maxNodes = std::max(maxNodes, nodes);
+    }
+    if (maxNodes > minNodes)
+        std::printf("runs 2-%d: %llu..%llu allocations over %llu..%llu nodes\n", opt.allocRuns, minAllocs,
+                    maxAllocs, minNodes, maxNodes);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        printUsage();
+        return 1;
+    }
+
+    if (opt.gridPasses > 0) {
+        benchGrid(opt.gridPasses);
+        return 0;
+    }
+
+    Trie dict;
+    if (!loadDictionary(opt.dictPath, dict)) return 1;
+    if (opt.verifyQueries > 0) return verify(dict, opt) ? 0 : 1;
+    if (opt.matchQueries > 0) {
+        benchMatch(dict, opt.matchQueries, opt.seed);
+        return 0;
+    }
+    if (opt.maskQueries > 0) {
+        benchMasks(dict, opt.maskQueries, opt.seed);
+        return 0;
+    }
+
+    // the same word set crossword_batch searches
+    Generator shared;
+    shared.loadWords(dict.allWords());
+    if (opt.batchGrids > 0) benchBatch(shared, dict, opt);
+    else benchAlloc(shared, opt);
+    return 0;
+}
@@ -1,11 +1,12 @@
 #include "CrosswordGrid.hpp"
 #include "GUI.hpp"
+#include "TemplateGenerator.hpp"
 
 int main() {
     CrosswordGrid grid(10, 10);
 
     // Randomize blocked cells with 25% density
-    grid.randomizeBlockedCells(0.25);
+    randomizeBlockedCells(grid, 0.25);
 
     GUI gui(grid);
     gui.run();
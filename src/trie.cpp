@@ -1,85 +1,1015 @@
 #include "trie.hpp"
+#include "MappedFile.hpp"
+#include <filesystem>
 #include <fstream>
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <atomic>
+#include <thread>
 
-Trie::Trie() : root(std::make_unique<Node>()) {}
+namespace {
 
-void Trie::insert(const std::string& word) {
-    Node* cur = root.get();
+int popcount32(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    return (int)((((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
+}
+
+// Image layout: ImageHeader, then nodeCount 16-byte nodes. All fields are in the writer's
+// byte order; byteOrder lets a reader with the other order refuse the file.
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t flags;
+    uint32_t nodeCount;
+    uint64_t checksum; // FNV-1a over the node bytes
+};
+static_assert(sizeof(ImageHeader) == 32, "image header must stay 32 bytes");
+
+const char ImageMagic[8] = { 'C', 'W', 'T', 'R', 'I', 'E', 0, 0 };
+const uint32_t ImageVersion = 3; // 2: nodes carry the length mask, 3: and scores
+const uint32_t ImageByteOrder = 0x01020304u;
+const uint32_t ImageMinimized = 1u;
+
+uint64_t fnv1a(const unsigned char* p, size_t n) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+bool isSeparator(char ch) {
+    return ch == ';' || ch == ',' || std::isspace(static_cast<unsigned char>(ch));
+}
+
+// Word list syntax shared by the loaders: fields are separated by whitespace, ';' or ','. A
+// field of digits is the score of the word before it; any other field is a word, kept as
+// its letters in uppercase. Calls emit(const std::string& word, unsigned score) per word.
+template <typename F>
+void parseWordList(const char* p, const char* end, F&& emit) {
+    std::string pending;
+    while (p < end) {
+        while (p < end && isSeparator(*p)) ++p;
+        const char* start = p;
+        bool digits = true;
+        for (; p < end && !isSeparator(*p); ++p) digits = digits && std::isdigit(static_cast<unsigned char>(*p));
+        if (start == p) break;
+        if (digits) {
+            if (pending.empty()) continue;
+            unsigned score = 0;
+            for (const char* q = start; q < p; ++q) score = std::min(score * 10 + (unsigned)(*q - '0'), Trie::MaxScore);
+            emit(pending, score);
+            pending.clear();
+            continue;
+        }
+        if (!pending.empty()) emit(pending, 0u);
+        pending.clear();
+        for (const char* q = start; q < p; ++q)
+            if (std::isalpha(static_cast<unsigned char>(*q))) pending.push_back((char)std::toupper(static_cast<unsigned char>(*q)));
+    }
+    if (!pending.empty()) emit(pending, 0u);
+}
+
+// The whole file through a stream, for a list that cannot be mapped (an empty file, for
+// one); false if it cannot be read
+bool readWhole(const std::string& path, std::string& out) {
+    std::error_code ec;
+    if (std::filesystem::is_directory(path, ec)) return false;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+// Start of the chunk that should begin near pos: the next line that does not open with a
+// score, so a word and its score always end up in the same chunk
+size_t chunkStart(const char* text, size_t size, size_t pos) {
+    while (pos < size) {
+        const char* nl = static_cast<const char*>(std::memchr(text + pos, '\n', size - pos));
+        if (!nl) return size;
+        pos = (size_t)(nl - text) + 1;
+        size_t q = pos;
+        while (q < size && isSeparator(text[q])) ++q;
+        if (q == size || !std::isdigit(static_cast<unsigned char>(text[q]))) return pos;
+    }
+    return size;
+}
+
+// Normalized words of one chunk, sorted and without duplicates
+struct WordRun {
+    struct Entry {
+        uint64_t key; // first 8 letters, big-endian, so most comparisons are one integer compare
+        uint32_t offset;
+        uint16_t length;
+        uint16_t score;
+    };
+    std::string chars;
+    std::vector<Entry> entries;
+
+    std::string_view word(const Entry& e) const { return std::string_view(chars.data() + e.offset, e.length); }
+    bool less(const Entry& a, const Entry& b) const { return a.key != b.key ? a.key < b.key : word(a) < word(b); }
+
+    void parse(const char* p, const char* end) {
+        parseWordList(p, end, [&](const std::string& w, unsigned score) {
+            if (w.size() > 0xFFFF) return; // not a word
+            uint64_t key = 0;
+            for (size_t i = 0; i < 8; ++i) key = (key << 8) | (i < w.size() ? (unsigned char)w[i] : 0u);
+            entries.push_back({key, (uint32_t)chars.size(), (uint16_t)w.size(), (uint16_t)score});
+            chars += w;
+        });
+        std::sort(entries.begin(), entries.end(), [&](const Entry& a, const Entry& b) { return less(a, b); });
+        // keep the highest score of each word
+        size_t out = 0;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (out > 0 && entries[out - 1].key == entries[i].key && word(entries[out - 1]) == word(entries[i])) {
+                entries[out - 1].score = std::max(entries[out - 1].score, entries[i].score);
+                continue;
+            }
+            entries[out++] = entries[i];
+        }
+        entries.resize(out);
+        entries.shrink_to_fit();
+    }
+};
+
+}
+
+// Daciuk-style construction from sorted words: only the path of the last word is still
+// open; everything left of it is final. When the next word leaves that path, the nodes
+// below the branch point are frozen bottom-up, and a frozen node's child block is looked up
+// in a register of the blocks already written so equal subtrees are stored once.
+struct Trie::Builder {
+    struct Pending {
+        uint32_t bits = 0;
+        uint16_t score = 0;
+        std::vector<Node> children;
+    };
+    struct Entry {
+        uint64_t hash = 0;
+        uint32_t first = 0, count = 0; // count 0 marks an empty entry
+    };
+
+    std::vector<Node> out = std::vector<Node>(1); // out[0] is reserved for the root
+    std::vector<Pending> path = std::vector<Pending>(1);
+    size_t depth = 0;
+    std::string prev;
+    std::vector<Entry> table = std::vector<Entry>(1024);
+    size_t used = 0;
+
+    bool add(std::string_view w, uint16_t score = 0);
+    void finish();
+    Node freeze(const Pending& p);
+    void grow();
+
+    static uint64_t hashBlock(const Node* block, size_t count) {
+        uint64_t h = 1469598103934665603ull;
+        for (size_t i = 0; i < count; ++i) {
+            h = (h ^ block[i].bits) * 1099511628211ull;
+            h = (h ^ block[i].first) * 1099511628211ull;
+            h = (h ^ block[i].lengths) * 1099511628211ull;
+            h = (h ^ (block[i].score | (uint32_t)block[i].best << 16)) * 1099511628211ull;
+        }
+        return h ^ (h >> 29);
+    }
+};
+
+bool Trie::Builder::add(std::string_view w, uint16_t score) {
+    size_t common = 0;
+    while (common < prev.size() && common < w.size() && prev[common] == w[common]) ++common;
+    if (common < prev.size() && (common == w.size() || w[common] < prev[common])) return false;
+
+    while (depth > common) {
+        Node n = freeze(path[depth]);
+        --depth;
+        path[depth].children.back() = n;
+    }
+    for (size_t i = common; i < w.size(); ++i) {
+        path[depth].bits |= 1u << (w[i] - 'A');
+        path[depth].children.emplace_back();
+        ++depth;
+        if (path.size() <= depth) path.emplace_back();
+        path[depth].bits = 0;
+        path[depth].score = 0;
+        path[depth].children.clear();
+    }
+    path[depth].bits |= EndBit;
+    path[depth].score = std::max(path[depth].score, score);
+    prev.assign(w.data(), w.size());
+    return true;
+}
+
+void Trie::Builder::finish() {
+    while (depth > 0) {
+        Node n = freeze(path[depth]);
+        --depth;
+        path[depth].children.back() = n;
+    }
+    out[0] = freeze(path[0]);
+}
+
+Trie::Node Trie::Builder::freeze(const Pending& p) {
+    uint32_t count = (uint32_t)p.children.size();
+    Node n;
+    n.bits = p.bits | (count << CapShift);
+    // a word ending here has length 0 below this node; every child adds one letter
+    n.lengths = (p.bits & EndBit) ? 1u : 0u;
+    n.score = n.best = p.score;
+    for (const Node& c : p.children) {
+        n.lengths |= (c.lengths << 1) | (c.lengths & LongBit);
+        n.best = std::max(n.best, c.best);
+    }
+    if (count == 0) return n;
+    const Node* block = p.children.data();
+    uint64_t h = hashBlock(block, count);
+    size_t mask = table.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        Entry& e = table[i];
+        if (e.count == 0) {
+            e.hash = h;
+            e.first = (uint32_t)out.size();
+            e.count = count;
+            out.insert(out.end(), p.children.begin(), p.children.end());
+            n.first = e.first;
+            if (++used * 2 > table.size()) grow();
+            return n;
+        }
+        if (e.hash == h && e.count == count && std::equal(block, block + count, out.begin() + e.first)) {
+            n.first = e.first;
+            return n;
+        }
+    }
+}
+
+void Trie::Builder::grow() {
+    std::vector<Entry> old(table.size() * 2);
+    old.swap(table);
+    size_t mask = table.size() - 1;
+    for (const Entry& e : old) {
+        if (e.count == 0) continue;
+        size_t i = e.hash & mask;
+        while (table[i].count != 0) i = (i + 1) & mask;
+        table[i] = e;
+    }
+}
+
+Trie::Trie() : nodes(1) {}
+
+int Trie::rank(uint32_t bits, int letter) {
+    return popcount32(bits & LetterMask & ((1u << letter) - 1));
+}
+
+uint32_t Trie::child(uint32_t node, int letter) const {
+    const Node& n = view()[node];
+    if (!(n.bits & (1u << letter))) return 0;
+    return n.first + rank(n.bits, letter);
+}
+
+uint32_t Trie::addChild(uint32_t node, int letter) {
+    uint32_t bits = nodes[node].bits;
+    uint32_t first = nodes[node].first;
+    int count = popcount32(bits & LetterMask);
+    int cap = (int)(bits >> CapShift);
+    if (count == cap) {
+        // block is full: move it to the end of the array with twice the room (at most 26).
+        // Only the parent refers to a block, so nothing else needs fixing up.
+        int newCap = std::min(26, std::max(1, cap * 2));
+        uint32_t moved = (uint32_t)nodes.size();
+        nodes.resize(nodes.size() + newCap);
+        std::copy(nodes.begin() + first, nodes.begin() + first + count, nodes.begin() + moved);
+        first = moved;
+        bits = (bits & ~(31u << CapShift)) | ((uint32_t)newCap << CapShift);
+    }
+    int pos = rank(bits, letter);
+    auto block = nodes.begin() + first;
+    std::copy_backward(block + pos, block + count, block + count + 1);
+    block[pos] = Node();
+    nodes[node].bits = bits | (1u << letter);
+    nodes[node].first = first;
+    return first + pos;
+}
+
+void Trie::insert(const std::string& word, unsigned score) {
+    detach();
+    dropPacked();
+    if (minimized) expand();
+    uint16_t s = (uint16_t)std::min(score, MaxScore);
+    size_t remaining = 0;
+    for (char ch : word) if (std::isalpha(static_cast<unsigned char>(ch))) ++remaining;
+    uint32_t cur = 0;
+    nodes[cur].lengths |= lengthBit(remaining);
+    nodes[cur].best = std::max(nodes[cur].best, s);
     for (char ch : word) {
         if (!std::isalpha(static_cast<unsigned char>(ch))) continue;
         int i = std::toupper(static_cast<unsigned char>(ch)) - 'A';
-        if (!cur->next[i]) cur->next[i] = std::make_unique<Node>();
-        cur = cur->next[i].get();
+        uint32_t next = child(cur, i);
+        cur = next ? next : addChild(cur, i);
+        nodes[cur].lengths |= lengthBit(--remaining);
+        nodes[cur].best = std::max(nodes[cur].best, s);
     }
-    cur->end = true;
+    nodes[cur].bits |= EndBit;
+    nodes[cur].score = std::max(nodes[cur].score, s);
 }
 
 bool Trie::contains(const std::string& word) const {
-    Node* cur = root.get();
+    uint32_t cur = 0;
     for (char ch : word) {
         if (!std::isalpha(static_cast<unsigned char>(ch))) return false;
         int i = std::toupper(static_cast<unsigned char>(ch)) - 'A';
-        if (!cur->next[i]) return false;
-        cur = cur->next[i].get();
+        cur = child(cur, i);
+        if (!cur) return false;
+    }
+    return (view()[cur].bits & EndBit) != 0;
+}
+
+unsigned Trie::scoreOf(const std::string& word) const {
+    uint32_t cur = 0;
+    for (char ch : word) {
+        if (!std::isalpha(static_cast<unsigned char>(ch))) return 0;
+        cur = child(cur, std::toupper(static_cast<unsigned char>(ch)) - 'A');
+        if (!cur) return 0;
     }
-    return cur->end;
+    const Node& n = view()[cur];
+    return (n.bits & EndBit) ? n.score : 0;
 }
 
 bool Trie::startsWith(const std::string& prefix) const {
-    Node* cur = root.get();
+    uint32_t cur = 0;
     for (char ch : prefix) {
         if (!std::isalpha(static_cast<unsigned char>(ch))) return false;
         int i = std::toupper(static_cast<unsigned char>(ch)) - 'A';
-        if (!cur->next[i]) return false;
-        cur = cur->next[i].get();
+        cur = child(cur, i);
+        if (!cur) return false;
     }
     return true;
 }
 
-bool Trie::loadFromFile(const std::string& path) {
-    std::ifstream in(path);
-    if (!in) return false;
-    std::string w;
-    while (in >> w) {
-        // normalize to uppercase
-        std::string tmp;
-        tmp.reserve(w.size());
-        for (char ch : w) if (std::isalpha(static_cast<unsigned char>(ch))) tmp.push_back(std::toupper(static_cast<unsigned char>(ch)));
-        if (!tmp.empty()) insert(tmp);
+bool Trie::loadFromFile(const std::string& path, bool minimize) {
+    if (minimize) return buildFromFile(path);
+    MappedFile file;
+    std::string copy;
+    if (!file.open(path) && !readWhole(path, copy)) return false;
+    const char* text = file.isOpen() ? reinterpret_cast<const char*>(file.bytes()) : copy.data();
+    size_t size = file.isOpen() ? file.size() : copy.size();
+    parseWordList(text, text + size, [&](const std::string& w, unsigned score) { insert(w, score); });
+    compact();
+    return true;
+}
+
+bool Trie::buildFromFile(const std::string& path, unsigned threads) {
+    // an empty file cannot be mapped, and a mapping can fail on a readable file; either way
+    // the list is read through a stream instead
+    MappedFile file;
+    std::string copy;
+    if (!file.open(path) && !readWhole(path, copy)) return false;
+    dropPacked();
+    const char* text = file.isOpen() ? reinterpret_cast<const char*>(file.bytes()) : copy.data();
+    size_t size = file.isOpen() ? file.size() : copy.size();
+
+    // Parse, sort and deduplicate chunks in parallel; offsets within a chunk stay 32-bit
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunks = std::max<size_t>(threads, size / (1u << 30) + 1);
+    std::vector<size_t> bounds(chunks + 1, size);
+    bounds[0] = 0;
+    for (size_t c = 1; c < chunks; ++c) bounds[c] = chunkStart(text, size, std::max(bounds[c - 1], size / chunks * c));
+    std::vector<WordRun> runs(chunks);
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t c = next++; c < chunks; c = next++) runs[c].parse(text + bounds[c], text + bounds[c + 1]);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < chunks; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    file.close();
+    std::string().swap(copy);
+
+    // Merge the runs in order straight into the builder
+    Builder builder;
+    std::vector<size_t> pos(chunks, 0);
+    auto later = [&](size_t a, size_t b) {
+        const WordRun::Entry& x = runs[a].entries[pos[a]];
+        const WordRun::Entry& y = runs[b].entries[pos[b]];
+        return x.key != y.key ? x.key > y.key : runs[a].word(x) > runs[b].word(y);
+    };
+    std::vector<size_t> heap;
+    for (size_t c = 0; c < chunks; ++c) if (!runs[c].entries.empty()) heap.push_back(c);
+    std::make_heap(heap.begin(), heap.end(), later);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        size_t c = heap.back();
+        const WordRun::Entry& e = runs[c].entries[pos[c]];
+        builder.add(runs[c].word(e), e.score);
+        if (++pos[c] < runs[c].entries.size()) std::push_heap(heap.begin(), heap.end(), later);
+        else {
+            heap.pop_back();
+            runs[c] = WordRun();
+        }
     }
+    builder.finish();
+    builder.out.shrink_to_fit();
+    nodes.swap(builder.out);
+    image.reset();
+    imageNodes = nullptr;
+    minimized = true;
     return true;
 }
 
-std::vector<std::string> Trie::collectWithPattern(const std::string& pattern) const {
+void Trie::compact() {
+    // a minimized graph is already tight, and copying it as a tree would undo the sharing
+    if (minimized) return;
+    detach();
+    // breadth-first copy: every child block is written right after the blocks before it
+    // and holds exactly as many nodes as the parent has children
+    std::vector<Node> packed;
+    std::vector<uint32_t> source; // old id of every packed node
+    packed.reserve(nodes.size());
+    source.reserve(nodes.size());
+    packed.emplace_back();
+    source.push_back(0);
+    for (size_t head = 0; head < source.size(); ++head) {
+        const Node& old = nodes[source[head]];
+        uint32_t letters = old.bits & LetterMask;
+        int count = popcount32(letters);
+        packed[head].bits = (old.bits & (LetterMask | EndBit)) | ((uint32_t)count << CapShift);
+        packed[head].first = (uint32_t)packed.size();
+        packed[head].lengths = old.lengths;
+        packed[head].score = old.score;
+        packed[head].best = old.best;
+        for (int k = 0; k < count; ++k) {
+            packed.emplace_back();
+            source.push_back(old.first + k);
+        }
+    }
+    packed.shrink_to_fit();
+    nodes.swap(packed);
+}
+
+template <typename F>
+void Trie::forEachWord(uint32_t node, std::string& cur, F& f) const {
+    const Node& n = view()[node];
+    if (n.bits & EndBit) f(cur, n.score);
+    uint32_t letters = n.bits & LetterMask;
+    for (uint32_t k = n.first; letters; ++k, letters &= letters - 1) {
+        cur.push_back('A' + lowestBit(letters));
+        forEachWord(k, cur, f);
+        cur.pop_back();
+    }
+}
+
+void Trie::minimize() {
+    if (minimized) return;
+    Builder builder;
+    std::string cur;
+    // depth-first in letter order yields the words already sorted
+    auto add = [&](const std::string& w, uint16_t score) { builder.add(w, score); };
+    forEachWord(0, cur, add);
+    builder.finish();
+    builder.out.shrink_to_fit();
+    nodes.swap(builder.out);
+    image.reset();
+    imageNodes = nullptr;
+    minimized = true;
+}
+
+bool Trie::buildSorted(const std::vector<std::string>& words, const std::vector<uint16_t>& scores) {
+    if (!scores.empty() && scores.size() != words.size()) return false;
+    Builder builder;
+    std::string tmp;
+    for (size_t i = 0; i < words.size(); ++i) {
+        tmp.clear();
+        for (char ch : words[i]) if (std::isalpha(static_cast<unsigned char>(ch))) tmp.push_back(std::toupper(static_cast<unsigned char>(ch)));
+        if (!tmp.empty() && !builder.add(tmp, scores.empty() ? 0 : scores[i])) return false;
+    }
+    dropPacked();
+    builder.finish();
+    builder.out.shrink_to_fit();
+    nodes.swap(builder.out);
+    image.reset();
+    imageNodes = nullptr;
+    minimized = true;
+    return true;
+}
+
+void Trie::expand() {
+    std::vector<std::string> words;
+    std::vector<uint16_t> scores;
+    std::string cur;
+    auto add = [&](const std::string& w, uint16_t score) {
+        words.push_back(w);
+        scores.push_back(score);
+    };
+    forEachWord(0, cur, add);
+    image.reset();
+    imageNodes = nullptr;
+    nodes.assign(1, Node());
+    minimized = false;
+    for (size_t i = 0; i < words.size(); ++i) insert(words[i], scores[i]);
+    compact();
+}
+
+std::vector<std::string> Trie::allWords() const {
     std::vector<std::string> out;
     std::string cur;
-    cur.reserve(pattern.size());
-    collectRec(root.get(), cur, pattern, out, 0);
+    auto add = [&](const std::string& w, uint16_t) { out.push_back(w); };
+    forEachWord(0, cur, add);
     return out;
 }
 
-void Trie::collectRec(Node* node, std::string& cur, const std::string& pattern, std::vector<std::string>& out, size_t idx) const {
-    if (!node) return;
-    if (idx == pattern.size()) {
-        if (node->end) out.push_back(cur);
+void Trie::usePackedLengths(uint32_t lengthMask) {
+    static_assert(PackedWords::MaxLength == 31, "bit k of the mask is length k");
+    lengthMask &= ~1u;
+    if (!lengthMask) {
+        dropPacked();
         return;
     }
-    char p = pattern[idx];
-    if (p == '_' || p == '?' ) {
-        for (int i = 0; i < 26; ++i) {
-            if (node->next[i]) {
-                cur.push_back('A' + i);
-                collectRec(node->next[i].get(), cur, pattern, out, idx + 1);
-                cur.pop_back();
+    auto scan = std::make_shared<PackedWords>();
+    scan->build(allWords(), lengthMask);
+    packed = std::move(scan);
+    packedMask = lengthMask;
+}
+
+std::vector<std::string> Trie::collectWithPattern(const std::string& pattern) const {
+    std::vector<std::string> out;
+    visitWithPattern(pattern, [&](std::string_view w) { out.emplace_back(w); return true; });
+    return out;
+}
+
+size_t Trie::countWithPattern(const std::string& pattern) const {
+    if (usesPacked(pattern)) return packed->countWithPattern(pattern);
+    size_t count = 0;
+    visitWithPattern(pattern, [&](std::string_view) { ++count; return true; });
+    return count;
+}
+
+bool Trie::anyWithPattern(const std::string& pattern) const {
+    return !visitWithPattern(pattern, [](std::string_view) { return false; });
+}
+
+size_t Trie::walkedNodes(const std::string& pattern, bool lengthMasks, size_t* matches) const {
+    size_t found = 0, walked = 0;
+    if (!lengthMasks || (view()[0].lengths & lengthBit(pattern.size())))
+        walked = walkedBelow(0, pattern, 0, lengthMasks, found);
+    if (matches) *matches = found;
+    return walked;
+}
+
+// Same descent as visitRec, counting the nodes it enters instead of reporting words
+size_t Trie::walkedBelow(uint32_t node, const std::string& pattern, size_t idx, bool lengthMasks, size_t& matches) const {
+    const Node* base = view();
+    const Node& n = base[node];
+    if (idx == pattern.size()) {
+        matches += (n.bits & EndBit) != 0;
+        return 1;
+    }
+    uint32_t need = lengthBit(pattern.size() - idx - 1);
+    uint32_t letters = n.bits & LetterMask;
+    uint32_t k = n.first;
+    unsigned char p = (unsigned char)pattern[idx];
+    if (p != '_' && p != '?') {
+        int i = std::isalpha(p) ? std::toupper(p) - 'A' : -1;
+        if (i < 0 || i >= 26 || !(letters & (1u << i))) return 1;
+        k += rank(n.bits, i);
+        letters = 1u << i;
+    }
+    size_t walked = 1;
+    for (; letters; ++k, letters &= letters - 1)
+        if (!lengthMasks || (base[k].lengths & need)) walked += walkedBelow(k, pattern, idx + 1, lengthMasks, matches);
+    return walked;
+}
+
+std::vector<std::string> Trie::firstWithPattern(const std::string& pattern, size_t k) const {
+    std::vector<std::string> out;
+    if (k == 0) return out;
+    visitWithPattern(pattern, [&](std::string_view w) { out.emplace_back(w); return out.size() < k; });
+    return out;
+}
+
+// Batch state. Patterns are interned back to front into suffix ids, a suffix being its first
+// letter plus the id of the rest (0: empty), so equal patterns and equal tails share ids.
+// Counting keeps a table of matches(node, suffix) for all-wildcard suffixes: slots of a
+// grid repeat those ("____", "_ES" after the first letter...), and in a minimized graph
+// many paths meet at the same node, so a repeated pair is answered without a descent.
+// Patterns without a wildcard are plain lookups with nothing to share, so sortOut answers
+// them before any table is set up; a batch left with too few patterns to walk to pay for the
+// tables goes through the single-pattern calls instead.
+struct Trie::BatchWalk {
+    // Open-addressing map from a 64-bit key to a 32-bit value; key ~0 marks a free slot
+    struct Table {
+        std::vector<uint64_t> keys;
+        std::vector<uint32_t> values;
+        size_t used = 0;
+
+        void reset(size_t expected) {
+            size_t cap = 64;
+            while (cap < expected * 2) cap *= 2;
+            keys.assign(cap, ~0ull);
+            values.assign(cap, 0);
+            used = 0;
+        }
+        // Slot holding key, or the free slot where it belongs
+        size_t find(uint64_t key) const {
+            size_t mask = keys.size() - 1;
+            size_t i = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+            while (keys[i] != key && keys[i] != ~0ull) i = (i + 1) & mask;
+            return i;
+        }
+        void put(size_t slot, uint64_t key, uint32_t value) {
+            keys[slot] = key;
+            values[slot] = value;
+            if (++used * 2 > keys.size()) grow();
+        }
+        void grow() {
+            std::vector<uint64_t> oldKeys(keys.size() * 2, ~0ull);
+            std::vector<uint32_t> oldValues(keys.size() * 2, 0);
+            oldKeys.swap(keys);
+            oldValues.swap(values);
+            for (size_t i = 0; i < oldKeys.size(); ++i) {
+                if (oldKeys[i] == ~0ull) continue;
+                size_t slot = find(oldKeys[i]);
+                keys[slot] = oldKeys[i];
+                values[slot] = oldValues[i];
+            }
+        }
+    };
+
+    struct Suffix {
+        int8_t letter;   // 0-25, 26 wildcard
+        bool open;       // wildcards only
+        uint32_t length;
+        uint32_t rest;
+    };
+
+    // Walking a short suffix is cheaper than a table lookup
+    static constexpr uint32_t MemoLength = 3;
+    // Fewest patterns left to walk that are worth a batch walk
+    static constexpr size_t MinPatterns = 4;
+    static constexpr int64_t Plain = -2; // id of a pattern sortOut answered
+
+    // Set plain[p] to the plainMatch of every pattern; true if enough are left (-1) to walk
+    static bool sortOut(const Trie& trie, const std::vector<std::string>& patterns, std::vector<int8_t>& plain) {
+        plain.resize(patterns.size());
+        size_t open = 0;
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            plain[p] = (int8_t)trie.plainMatch(patterns[p]);
+            if (plain[p] < 0) ++open;
+        }
+        return open >= MinPatterns;
+    }
+    // The one word a pattern with plainMatch 1 matches
+    static std::string plainWord(const std::string& pattern) {
+        std::string w = pattern;
+        for (auto& ch : w)
+            if (ch < 'A' || ch > 'Z') ch = (char)std::toupper(static_cast<unsigned char>(ch)); // cheap for the usual uppercase
+        return w;
+    }
+
+    const Node* base;
+    std::vector<int64_t> ids; // per pattern, -1 if it can match nothing, or Plain
+    std::vector<Suffix> suffixes = std::vector<Suffix>(1, Suffix{0, true, 0, 0});
+    Table interned, matches;
+    std::string buf;
+
+    explicit BatchWalk(const Node* nodes) : base(nodes) {}
+    void prepare(const std::vector<std::string>& patterns, const std::vector<int8_t>& plain);
+
+    uint32_t intern(int letter, uint32_t rest) {
+        uint64_t key = ((uint64_t)letter << 32) | rest;
+        size_t slot = interned.find(key);
+        if (interned.keys[slot] == key) return interned.values[slot];
+        uint32_t id = (uint32_t)suffixes.size();
+        suffixes.push_back({(int8_t)letter, letter == 26 && suffixes[rest].open, suffixes[rest].length + 1, rest});
+        interned.put(slot, key, id);
+        return id;
+    }
+
+    uint32_t count(uint32_t node, uint32_t id) {
+        const Node& n = base[node];
+        if (id == 0) return (n.bits & EndBit) ? 1 : 0;
+        const Suffix s = suffixes[id];
+        uint32_t need = lengthBit(s.length - 1);
+        if (s.letter < 26) {
+            if (!(n.bits & (1u << s.letter))) return 0;
+            uint32_t k = n.first + rank(n.bits, s.letter);
+            return (base[k].lengths & need) ? count(k, s.rest) : 0;
+        }
+        bool remember = s.open && s.length >= MemoLength;
+        uint64_t key = ((uint64_t)node << 32) | id;
+        if (remember) {
+            size_t slot = matches.find(key);
+            if (matches.keys[slot] == key) return matches.values[slot];
+        }
+        uint32_t total = 0;
+        uint32_t letters = n.bits & LetterMask;
+        for (uint32_t k = n.first; letters; ++k, letters &= letters - 1)
+            if (base[k].lengths & need) total += count(k, s.rest);
+        if (remember) matches.put(matches.find(key), key, total);
+        return total;
+    }
+
+    template <typename F>
+    bool walk(uint32_t node, uint32_t id, size_t idx, F& f) {
+        const Node& n = base[node];
+        if (id == 0) return (n.bits & EndBit) ? f(std::string_view(buf.data(), idx)) : true;
+        const Suffix s = suffixes[id];
+        uint32_t need = lengthBit(s.length - 1);
+        uint32_t letters = n.bits & LetterMask;
+        uint32_t k = n.first;
+        if (s.letter < 26) {
+            if (!(letters & (1u << s.letter))) return true;
+            k += rank(n.bits, s.letter);
+            letters = 1u << s.letter;
+        }
+        for (; letters; ++k, letters &= letters - 1) {
+            if (!(base[k].lengths & need)) continue;
+            buf[idx] = (char)('A' + lowestBit(letters));
+            if (!walk(k, s.rest, idx + 1, f)) return false;
+        }
+        return true;
+    }
+
+    // f(size_t pattern, std::string_view word); a pattern equal to an earlier one is not
+    // walked again if same(pattern, earlier) takes over its results. The matches of the
+    // patterns sortOut answered are reported in their place in the order.
+    template <typename F, typename Same>
+    bool visit(const std::vector<std::string>& patterns, const std::vector<int8_t>& plain, F&& f, Same&& same) {
+        prepare(patterns, plain);
+        std::vector<int64_t> firstOf(suffixes.size(), -1);
+        std::string word;
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            if (ids[p] == Plain) {
+                if (plain[p] > 0 && !f(p, std::string_view(word = plainWord(patterns[p])))) return false;
+                continue;
+            }
+            if (ids[p] < 0 || !(base[0].lengths & lengthBit(patterns[p].size()))) continue;
+            int64_t& first = firstOf[(size_t)ids[p]];
+            if (first >= 0 && same(p, (size_t)first)) continue;
+            if (first < 0) first = (int64_t)p;
+            auto report = [&](std::string_view word) { return f(p, word); };
+            if (!walk(0, (uint32_t)ids[p], 0, report)) return false;
+        }
+        return true;
+    }
+};
+
+void Trie::BatchWalk::prepare(const std::vector<std::string>& patterns, const std::vector<int8_t>& plain) {
+    size_t maxLen = 0, total = 0;
+    for (size_t p = 0; p < patterns.size(); ++p) {
+        if (plain[p] >= 0) continue;
+        maxLen = std::max(maxLen, patterns[p].size());
+        total += patterns[p].size();
+    }
+    interned.reset(total);
+    matches.reset(total * 8);
+    buf.assign(maxLen, ' ');
+    // a character that is neither a letter nor a wildcard matches nothing, as in the
+    // single-pattern walk
+    ids.assign(patterns.size(), -1);
+    for (size_t p = 0; p < patterns.size(); ++p) {
+        if (plain[p] >= 0) {
+            ids[p] = Plain;
+            continue;
+        }
+        uint32_t id = 0;
+        bool valid = true;
+        for (size_t d = patterns[p].size(); valid && d-- > 0;) {
+            unsigned char ch = (unsigned char)patterns[p][d];
+            int letter = (ch == '_' || ch == '?') ? 26 : std::isalpha(ch) ? std::toupper(ch) - 'A' : -1;
+            if (letter < 0 || letter > 26) valid = false;
+            else id = intern(letter, id);
+        }
+        if (valid) ids[p] = id;
+    }
+}
+
+// Matches (0 or 1) of a pattern without wildcards, by a plain lookup; -1 if it has a
+// wildcard after a prefix that is present. A missing prefix or a character that is neither
+// a letter nor a wildcard matches nothing, whatever follows.
+int Trie::plainMatch(const std::string& pattern) const {
+    uint32_t cur = 0;
+    for (char ch : pattern) {
+        if (ch == '_' || ch == '?') return -1;
+        int i = std::isalpha(static_cast<unsigned char>(ch)) ? std::toupper(static_cast<unsigned char>(ch)) - 'A' : -1;
+        if (i < 0 || i >= 26 || !(cur = child(cur, i))) return 0;
+    }
+    return (view()[cur].bits & EndBit) ? 1 : 0;
+}
+
+bool Trie::visitMany(const std::vector<std::string>& patterns, MatchFn fn, void* ctx) const {
+    std::vector<int8_t> plain;
+    if (!BatchWalk::sortOut(*this, patterns, plain)) {
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            if (plain[p] == 0) continue;
+            if (plain[p] > 0) {
+                std::string word = BatchWalk::plainWord(patterns[p]);
+                if (!fn(ctx, p, word)) return false;
+            } else if (!visitWithPattern(patterns[p], [&](std::string_view word) { return fn(ctx, p, word); })) {
+                return false;
             }
         }
-    } else if (std::isalpha(static_cast<unsigned char>(p))) {
-        int i = std::toupper(static_cast<unsigned char>(p)) - 'A';
-        if (i >=0 && i < 26 && node->next[i]) {
-            cur.push_back('A' + i);
-            collectRec(node->next[i].get(), cur, pattern, out, idx + 1);
-            cur.pop_back();
+        return true;
+    }
+    BatchWalk w(view());
+    return w.visit(patterns, plain, [&](size_t p, std::string_view word) { return fn(ctx, p, word); },
+                   [](size_t, size_t) { return false; });
+}
+
+// Depth-first branch and bound for topKWithPattern. Children are tried best subtree first,
+// so good words are found early and the k-th best score rises quickly; a subtree whose best
+// score cannot beat the current k-th result is skipped without being opened.
+struct Trie::TopK {
+    struct Hit {
+        uint16_t score;
+        std::string word;
+    };
+
+    const Node* base;
+    const std::string& pattern;
+    size_t k;
+    std::vector<Hit> hits; // best first, at most k
+    std::string buf;
+
+    TopK(const Node* nodes, const std::string& pat, size_t count) : base(nodes), pattern(pat), k(count), buf(pat.size(), ' ') {}
+
+    // Could a word scoring at most bound, starting with the first len letters of buf, still
+    // make the list? On equal scores the alphabetically smaller word wins.
+    bool canBeat(uint16_t bound, size_t len) const {
+        if (hits.size() < k) return true;
+        const Hit& last = hits.back();
+        if (bound != last.score) return bound > last.score;
+        return std::string_view(buf.data(), len) <= std::string_view(last.word).substr(0, len);
+    }
+
+    void add(uint16_t score) {
+        if (!canBeat(score, buf.size())) return;
+        auto pos = std::find_if(hits.begin(), hits.end(), [&](const Hit& h) {
+            return score > h.score || (score == h.score && buf < h.word);
+        });
+        if (hits.size() == k) hits.pop_back();
+        hits.insert(pos, Hit{score, buf});
+    }
+
+    void search(uint32_t node, size_t idx) {
+        const Node& n = base[node];
+        if (idx == pattern.size()) {
+            add(n.score);
+            return;
+        }
+        uint32_t letters = n.bits & LetterMask;
+        unsigned char p = (unsigned char)pattern[idx];
+        if (p != '_' && p != '?') {
+            int i = std::isalpha(p) ? std::toupper(p) - 'A' : -1;
+            letters &= (i >= 0 && i < 26) ? 1u << i : 0u;
+        }
+        uint32_t need = lengthBit(pattern.size() - idx - 1);
+        bool last = idx + 1 == pattern.size();
+        struct Option {
+            uint16_t bound;
+            uint32_t node;
+            char letter;
+        };
+        Option options[26];
+        int count = 0;
+        for (uint32_t rest = letters; rest; rest &= rest - 1) {
+            int i = lowestBit(rest);
+            uint32_t c = n.first + rank(n.bits, i);
+            if (!(base[c].lengths & need)) continue;
+            Option o{last ? base[c].score : base[c].best, c, (char)('A' + i)};
+            // insertion sort, best bound first; equal bounds keep letter order
+            int j = count++;
+            for (; j > 0 && options[j - 1].bound < o.bound; --j) options[j] = options[j - 1];
+            options[j] = o;
+        }
+        for (int j = 0; j < count; ++j) {
+            buf[idx] = options[j].letter;
+            if (!canBeat(options[j].bound, idx + 1)) {
+                // later options have lower bounds; with an equal bound only a later letter
+                if (hits.size() == k && options[j].bound < hits.back().score) break;
+                continue;
+            }
+            search(options[j].node, idx + 1);
         }
     }
+};
+
+std::vector<std::string> Trie::topKWithPattern(const std::string& pattern, size_t k) const {
+    std::vector<std::string> out;
+    const Node* base = view();
+    if (k == 0 || !(base[0].lengths & lengthBit(pattern.size()))) return out;
+    TopK search(base, pattern, k);
+    search.search(0, 0);
+    for (auto& h : search.hits) out.push_back(std::move(h.word));
+    return out;
+}
+
+std::vector<std::vector<std::string>> Trie::collectWithPatterns(const std::vector<std::string>& patterns) const {
+    std::vector<std::vector<std::string>> out(patterns.size());
+    std::vector<int8_t> plain;
+    if (!BatchWalk::sortOut(*this, patterns, plain)) {
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            if (plain[p] > 0) out[p].push_back(BatchWalk::plainWord(patterns[p]));
+            else if (plain[p] < 0) out[p] = collectWithPattern(patterns[p]);
+        }
+        return out;
+    }
+    BatchWalk(view()).visit(patterns, plain, [&](size_t i, std::string_view w) { out[i].emplace_back(w); return true; },
+                            [&](size_t i, size_t first) { out[i] = out[first]; return true; });
+    return out;
+}
+
+std::vector<size_t> Trie::countWithPatterns(const std::vector<std::string>& patterns) const {
+    std::vector<size_t> out(patterns.size(), 0);
+    std::vector<int8_t> plain;
+    if (!BatchWalk::sortOut(*this, patterns, plain)) {
+        for (size_t p = 0; p < patterns.size(); ++p)
+            out[p] = plain[p] >= 0 ? (size_t)plain[p] : countWithPattern(patterns[p]);
+        return out;
+    }
+    BatchWalk w(view());
+    w.prepare(patterns, plain);
+    for (size_t p = 0; p < patterns.size(); ++p) {
+        if (plain[p] >= 0) out[p] = (size_t)plain[p];
+        else if (w.ids[p] >= 0 && (w.base[0].lengths & lengthBit(patterns[p].size())))
+            out[p] = w.count(0, (uint32_t)w.ids[p]);
+    }
+    return out;
+}
+
+bool Trie::saveImage(const std::string& path, std::string* error) const {
+    static_assert(sizeof(Node) == 16, "image nodes are four 32-bit words");
+    // write beside the target and rename over it, so a process that still maps the old
+    // image (or reloads while this runs) never sees a truncated file; MappedFile shares
+    // delete access so that the rename is allowed on Windows too
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary);
+    if (!out) {
+        if (error) *error = "cannot create " + tmp;
+        return false;
+    }
+    ImageHeader header;
+    std::memcpy(header.magic, ImageMagic, sizeof(header.magic));
+    header.version = ImageVersion;
+    header.byteOrder = ImageByteOrder;
+    header.flags = minimized ? ImageMinimized : 0;
+    header.nodeCount = (uint32_t)nodeCount();
+    const unsigned char* body = reinterpret_cast<const unsigned char*>(view());
+    size_t bodySize = nodeCount() * sizeof(Node);
+    header.checksum = fnv1a(body, bodySize);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(body), (std::streamsize)bodySize);
+    out.close();
+    std::error_code ec;
+    if (!out) {
+        if (error) *error = "cannot write " + tmp;
+    } else {
+        std::filesystem::rename(tmp, path, ec);
+        if (!ec) return true;
+        if (error) *error = "cannot replace " + path + " with " + tmp + ": " + ec.message();
+    }
+    std::filesystem::remove(tmp, ec);
+    return false;
+}
+
+bool Trie::mapImage(const std::string& path, bool verify) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(path) || file->size() < sizeof(ImageHeader)) return false;
+    ImageHeader header;
+    std::memcpy(&header, file->bytes(), sizeof(header));
+    if (std::memcmp(header.magic, ImageMagic, sizeof(header.magic)) != 0 ||
+        header.version != ImageVersion || header.byteOrder != ImageByteOrder || header.nodeCount == 0 ||
+        file->size() != sizeof(ImageHeader) + (size_t)header.nodeCount * sizeof(Node))
+        return false;
+
+    const Node* mapped = reinterpret_cast<const Node*>(file->bytes() + sizeof(ImageHeader));
+    if (verify) {
+        if (fnv1a(file->bytes() + sizeof(ImageHeader), file->size() - sizeof(ImageHeader)) != header.checksum)
+            return false;
+        for (uint32_t i = 0; i < header.nodeCount; ++i) {
+            uint32_t count = (uint32_t)popcount32(mapped[i].bits & LetterMask);
+            if (count && (mapped[i].first == 0 || (uint64_t)mapped[i].first + count > header.nodeCount)) return false;
+        }
+    }
+
+    dropPacked();
+    image = file;
+    imageNodes = mapped;
+    imageCount = header.nodeCount;
+    minimized = (header.flags & ImageMinimized) != 0;
+    nodes.clear();
+    nodes.shrink_to_fit();
+    return true;
+}
+
+void Trie::detach() {
+    if (!imageNodes) return;
+    nodes.assign(imageNodes, imageNodes + imageCount);
+    image.reset();
+    imageNodes = nullptr;
+    imageCount = 0;
 }
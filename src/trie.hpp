@@ -1,24 +1,221 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cctype>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
 #include <memory>
+#include "PackedWords.hpp"
+
+class MappedFile;
 
 class Trie {
 public:
     Trie();
-    void insert(const std::string& word);
+    // Scores rank words for topKWithPattern (higher is better, at most MaxScore); a word
+    // inserted twice keeps its higher score
+    static constexpr unsigned MaxScore = 65535;
+    void insert(const std::string& word, unsigned score = 0);
     bool contains(const std::string& word) const;
     bool startsWith(const std::string& prefix) const;
-    bool loadFromFile(const std::string& path);
+    unsigned scoreOf(const std::string& word) const; // 0 if absent
+    // One word per entry, optionally followed by its score ("WORD 50", "WORD;50");
+    // whitespace, ';' and ',' separate fields. With minimize set the file is built straight
+    // into a minimized graph (see buildFromFile).
+    bool loadFromFile(const std::string& path, bool minimize = false);
     std::vector<std::string> collectWithPattern(const std::string& pattern) const; // pattern: letters or '_' for unknown
+    std::vector<std::string> allWords() const; // alphabetical
+
+    // Pattern queries that do not build the full result. All of them share one traversal
+    // (visitWithPattern) and, apart from the returned vector of firstWithPattern, allocate
+    // nothing for patterns up to 64 letters.
+    size_t countWithPattern(const std::string& pattern) const;
+    bool anyWithPattern(const std::string& pattern) const;
+    std::vector<std::string> firstWithPattern(const std::string& pattern, size_t k) const; // at most k, in order
+    // The k best-scored matches, best first (equal scores alphabetically). Every node knows
+    // the best score below it, so the search only opens subtrees that can still beat the
+    // k-th result found so far; it does not enumerate the other matches.
+    std::vector<std::string> topKWithPattern(const std::string& pattern, size_t k) const;
+
+    // Call f(std::string_view word) for every match in alphabetical order; f returns false
+    // to stop. The view is only valid during the call. Returns false if f stopped the walk.
+    template <typename F>
+    bool visitWithPattern(const std::string& pattern, F&& f) const {
+        if (usesPacked(pattern)) return packed->visitWithPattern(pattern, f);
+        if (!(view()[0].lengths & lengthBit(pattern.size()))) return true;
+        char small[64];
+        std::string large;
+        char* buf = small;
+        if (pattern.size() > sizeof(small)) {
+            large.resize(pattern.size());
+            buf = &large[0];
+        }
+        return visitRec(0, buf, pattern, 0, f);
+    }
+
+    // Batched queries for re-checking many slots at once. The batch shares its work:
+    // repeated patterns are walked once, and counts of all-wildcard tails below a node are
+    // computed once per batch, however many patterns and paths reach that node. Patterns
+    // without a wildcard, and batches of fewer than four wildcard patterns, go through the
+    // single-pattern calls, which are faster there. Results per pattern are the same, and in
+    // the same order, as the single-pattern calls.
+    std::vector<std::vector<std::string>> collectWithPatterns(const std::vector<std::string>& patterns) const;
+    std::vector<size_t> countWithPatterns(const std::vector<std::string>& patterns) const;
+
+    // Call f(size_t patternIndex, std::string_view word) for every match of every pattern;
+    // f returns false to stop the whole walk. Returns false if f stopped it.
+    template <typename F>
+    bool visitWithPatterns(const std::vector<std::string>& patterns, F&& f) const {
+        using Fn = std::remove_reference_t<F>;
+        void* ctx = const_cast<void*>(static_cast<const void*>(&f));
+        return visitMany(patterns, [](void* c, size_t i, std::string_view w) { return (*static_cast<Fn*>(c))(i, w); }, ctx);
+    }
+
+    // Rewrite the node array breadth-first without the slack and abandoned blocks that
+    // inserts leave behind. loadFromFile does this once at the end; call it after other
+    // bulk inserts.
+    void compact();
+
+    // Merge equal subtrees so that shared suffixes ("-ING", "-ATION") are stored once,
+    // turning the trie into a minimal acyclic word graph. Lookups and pattern queries are
+    // unchanged. Inserting into a minimized trie expands it back into a plain trie first.
+    void minimize();
+    // Replace the contents with a minimized graph of words built incrementally, without a
+    // full trie in between. words must be in ascending order after normalization to
+    // uppercase (duplicates are fine); returns false and leaves the trie alone otherwise.
+    // scores, if not empty, holds the score of every word.
+    bool buildSorted(const std::vector<std::string>& words, const std::vector<uint16_t>& scores = {});
+    // Bulk build from a word list in any order: the file is mapped and split into chunks
+    // that are parsed, sorted and deduplicated on threads (0: one per core), then merged
+    // in order into buildSorted's builder. Replaces the contents; false if unreadable.
+    bool buildFromFile(const std::string& path, unsigned threads = 0);
+    bool isMinimized() const { return minimized; }
+
+    // Answer the single-pattern queries for the lengths set in lengthMask (bit k: length k,
+    // up to PackedWords::MaxLength) with a PackedWords scan instead of the graph walk; 0
+    // switches it off. Patterns without a wildcard are plain lookups and still walk the
+    // graph. Results and their order are the same either way. The scan copies the
+    // current words, so any insert or rebuild switches it off again. topKWithPattern and the
+    // batched queries always walk the graph.
+    void usePackedLengths(uint32_t lengthMask);
+    uint32_t packedLengths() const { return packedMask; }
+
+    // Binary image: a versioned header followed by the node array exactly as it is held in
+    // memory (indices only, so it is position independent). saveImage is the offline
+    // compile step; mapImage maps a saved image read-only and queries it in place, with no
+    // parsing or allocation, and every process mapping the same file shares its pages.
+    // verify checks the checksum and every child offset (reads the whole image once), so a
+    // truncated or corrupt file is refused instead of read out of bounds by a later query;
+    // pass false only for an image this process just wrote. Any later
+    // insert/compact/minimize copies the nodes back to the heap first.
+    // saveImage writes path.tmp and renames it over path; on failure error, if given, says
+    // which step failed and why.
+    bool saveImage(const std::string& path, std::string* error = nullptr) const;
+    bool mapImage(const std::string& path, bool verify = true);
+    bool isMapped() const { return imageNodes != nullptr; }
+
+    size_t nodeCount() const { return imageNodes ? imageCount : nodes.size(); }
+    // Nodes the graph walk of pattern enters, with or without the length-mask pruning
+    // (for benchmarks; the queries always prune). matches, if given, gets the words the walk
+    // reached, which is countWithPattern either way.
+    size_t walkedNodes(const std::string& pattern, bool lengthMasks = true, size_t* matches = nullptr) const;
+    size_t memoryBytes() const {
+        size_t graph = imageNodes ? imageCount * sizeof(Node) : nodes.capacity() * sizeof(Node);
+        return graph + (packed ? packed->memoryBytes() : 0);
+    }
 
 private:
+    // All nodes live in one array and the children of a node are a contiguous block of it,
+    // in letter order, so a child is found with one popcount and no pointer chasing. bits
+    // holds the child letters (bit i = 'A' + i), the end-of-word flag and the capacity of
+    // the child block that starts at nodes[first]. Once minimized, blocks are shared by
+    // every parent whose children are equal. Bit k of lengths is set if some word ends
+    // exactly k letters below the node (bit 31: 31 or more), so pattern queries can skip
+    // subtrees that hold no word of the remaining length. score belongs to the word ending
+    // here, best is the highest score of any word at or below the node.
     struct Node {
-        bool end = false;
-        std::unique_ptr<Node> next[26];
+        uint32_t bits = 0;
+        uint32_t first = 0;
+        uint32_t lengths = 0;
+        uint16_t score = 0;
+        uint16_t best = 0;
+        bool operator==(const Node& o) const {
+            return bits == o.bits && first == o.first && lengths == o.lengths && score == o.score && best == o.best;
+        }
     };
+    static constexpr uint32_t LetterMask = (1u << 26) - 1;
+    static constexpr uint32_t EndBit = 1u << 26;
+    static constexpr int CapShift = 27;
+    static constexpr uint32_t LongBit = 1u << 31;
+
+    static uint32_t lengthBit(size_t remaining) { return remaining >= 31 ? LongBit : 1u << remaining; }
+    static int lowestBit(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctz(x);
+#else
+        int i = 0;
+        while (!(x & 1u)) { x >>= 1; ++i; }
+        return i;
+#endif
+    }
+
+    std::vector<Node> nodes; // nodes[0] is the root; unused while an image is mapped
+    bool minimized = false;
+    std::shared_ptr<const MappedFile> image;
+    const Node* imageNodes = nullptr;
+    size_t imageCount = 0;
+    std::shared_ptr<const PackedWords> packed; // set while packedMask != 0
+    uint32_t packedMask = 0;
+
+    const Node* view() const { return imageNodes ? imageNodes : nodes.data(); }
+    void detach(); // copy a mapped image into nodes and unmap it
+    bool usesPacked(const std::string& pattern) const {
+        if (pattern.size() > PackedWords::MaxLength || !((packedMask >> pattern.size()) & 1u)) return false;
+        return pattern.find_first_of("_?") != std::string::npos;
+    }
+    void dropPacked() { packed.reset(); packedMask = 0; }
+
+    struct Builder; // sorted-input minimizing builder (trie.cpp)
+    struct BatchWalk; // state of a visitWithPatterns walk (trie.cpp)
+    struct TopK; // topKWithPattern search (trie.cpp)
+    using MatchFn = bool (*)(void* ctx, size_t pattern, std::string_view word);
+    int plainMatch(const std::string& pattern) const; // see trie.cpp
+    bool visitMany(const std::vector<std::string>& patterns, MatchFn fn, void* ctx) const;
 
-    std::unique_ptr<Node> root;
+    static int rank(uint32_t bits, int letter); // children before letter
+    uint32_t child(uint32_t node, int letter) const; // 0 if absent (the root is never a child)
+    uint32_t addChild(uint32_t node, int letter);
+    size_t walkedBelow(uint32_t node, const std::string& pattern, size_t idx, bool lengthMasks, size_t& matches) const;
+    void expand();
+    template <typename F>
+    void forEachWord(uint32_t node, std::string& cur, F& f) const;
 
-    void collectRec(Node* node, std::string& cur, const std::string& pattern, std::vector<std::string>& out, size_t idx) const;
+    template <typename F>
+    bool visitRec(uint32_t node, char* buf, const std::string& pattern, size_t idx, F& f) const {
+        const Node* base = view();
+        const Node& n = base[node];
+        if (idx == pattern.size()) return (n.bits & EndBit) ? f(std::string_view(buf, idx)) : true;
+        // children must hold a word exactly as long as what is left of the pattern
+        uint32_t need = lengthBit(pattern.size() - idx - 1);
+        char p = pattern[idx];
+        if (p == '_' || p == '?') {
+            // children are stored in letter order, so walk the set bits alongside the block
+            uint32_t letters = n.bits & LetterMask;
+            for (uint32_t k = n.first; letters; ++k, letters &= letters - 1) {
+                if (!(base[k].lengths & need)) continue;
+                buf[idx] = (char)('A' + lowestBit(letters));
+                if (!visitRec(k, buf, pattern, idx + 1, f)) return false;
+            }
+        } else if (std::isalpha(static_cast<unsigned char>(p))) {
+            int i = std::toupper(static_cast<unsigned char>(p)) - 'A';
+            uint32_t next = (i >= 0 && i < 26) ? child(node, i) : 0;
+            if (next && (base[next].lengths & need)) {
+                buf[idx] = (char)('A' + i);
+                return visitRec(next, buf, pattern, idx + 1, f);
+            }
+        }
+        return true;
+    }
 };